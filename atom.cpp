@@ -11,12 +11,12 @@ Atom::Atom()
 	insideLambda = false;
 }
 
-Atom::Atom(ComplexNumber value)
+Atom::Atom(ComplexNumber value): Atom()
 {
 	setComplex(value);
 }
 
-Atom::Atom(double value){
+Atom::Atom(double value): Atom(){
   setNumber(value);
 }
 
@@ -177,6 +177,15 @@ std::string Atom::asStringConstant() const noexcept
 	return result;
 }
 
+const std::string & Atom::asText() const noexcept
+{
+	static const std::string empty;
+	if (m_type == SymbolKind || m_type == StringKind)
+		return stringValue;
+
+	return empty;
+}
+
 ComplexNumber Atom::asComplexNumber() const noexcept
 {
 	ComplexNumber returnVariable(0, 0);
@@ -62,6 +62,9 @@ public:
   /// value of Atom as a string, return empty-string if not a string
   std::string asStringConstant() const noexcept;
 
+  /// text of a symbol or string without copying it, empty-string for other types
+  const std::string & asText() const noexcept;
+
   /// value of Atom as a complex number, return (0,0) if its not
   ComplexNumber asComplexNumber() const noexcept;
 
@@ -20,6 +20,8 @@ TEST_CASE( "Test constructors", "[atom]" ) {
     REQUIRE(!a.isNone());
     REQUIRE(a.isNumber());
     REQUIRE(!a.isSymbol());
+    REQUIRE(!a.isInsideLambda());
+    REQUIRE(!Atom(ComplexNumber(1, 2)).isInsideLambda());
   }
 
   {
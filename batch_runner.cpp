@@ -0,0 +1,164 @@
+#include "batch_runner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include "draw_buffer.hpp"
+#include "interpreter.hpp"
+#include "result_writer.hpp"
+#include "semantic_error.hpp"
+#include "startup_snapshot.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+bool writeTextFile(const std::string & path, const std::string & text)
+{
+	std::ofstream out(path);
+	out << text;
+	return bool(out);
+}
+
+// evaluate one script in interp, interp already holds the prelude
+BatchResult runScript(Interpreter interp, const std::string & script, const BatchOptions & options)
+{
+	BatchResult result;
+	result.script = script;
+
+	std::ifstream in(script);
+	if (!in)
+	{
+		result.message = "Error: Could not open file for reading.";
+		return result;
+	}
+
+	if (!interp.parseStream(in))
+	{
+		result.message = "Error: Invalid Program. Could not parse.";
+	}
+	else
+	{
+		try
+		{
+			Expression exp = interp.evaluate();
+			result.message = ResultWriter().format(exp);
+			result.ok = true;
+
+			if (!options.imageFormat.empty())
+			{
+				DrawBuffer commands;
+				buildDrawBuffer(exp, commands);
+				std::string image = batchOutputPath(script, options.outputDir, "." + options.imageFormat);
+				if (!renderToFile(commands, image, options.render))
+				{
+					result.ok = false;
+					result.message = "Error: Could not write " + image + ".";
+				}
+			}
+		}
+		catch (const SemanticError & ex)
+		{
+			result.message = ex.what();
+		}
+	}
+
+	// drop the result of a previous run so only one of the two files exists
+	std::string out_path = batchOutputPath(script, options.outputDir, ".out");
+	std::string err_path = batchOutputPath(script, options.outputDir, ".err");
+	std::remove(result.ok ? err_path.c_str() : out_path.c_str());
+	if (!writeTextFile(result.ok ? out_path : err_path, result.message + "\n"))
+	{
+		result.ok = false;
+		result.message = "Error: Could not write results of " + script + ".";
+	}
+	return result;
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+std::vector<std::string> readManifest(std::istream & manifest)
+{
+	std::vector<std::string> scripts;
+	std::string line;
+	while (std::getline(manifest, line))
+	{
+		std::size_t first = line.find_first_not_of(" \t\r");
+		if (first == std::string::npos || line[first] == ';')
+			continue;
+		std::size_t last = line.find_last_not_of(" \t\r");
+		scripts.push_back(line.substr(first, last - first + 1));
+	}
+	return scripts;
+}
+
+std::string batchOutputPath(const std::string & script, const std::string & outputDir, const std::string & extension)
+{
+	std::string base = script;
+	std::size_t slash = base.find_last_of("/\\");
+	std::size_t dot = base.find_last_of('.');
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		base.erase(dot);
+
+	if (outputDir.empty())
+		return base + extension;
+
+	if (slash != std::string::npos)
+		base.erase(0, slash + 1);
+	return outputDir + "/" + base + extension;
+}
+
+std::vector<BatchResult> runBatch(const std::vector<std::string> & scripts, const BatchOptions & options)
+{
+	std::vector<BatchResult> results(scripts.size());
+	std::atomic<std::size_t> next(0);
+
+	std::size_t jobs = options.jobs;
+	if (jobs == 0)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	jobs = std::min(jobs, std::max<std::size_t>(scripts.size(), 1));
+
+	auto worker = [&]() {
+		// the prelude is evaluated once and every script starts from a copy of it
+		Interpreter base;
+		std::string prelude_error;
+		if (!options.prelude.empty())
+		{
+			try
+			{
+				base = Interpreter(startupEnvironment(options.prelude));
+			}
+			catch (const SemanticError & ex)
+			{
+				prelude_error = ex.what();
+			}
+		}
+
+		for (std::size_t i = next++; i < scripts.size(); i = next++)
+		{
+			if (prelude_error.empty())
+			{
+				results[i] = runScript(base, scripts[i], options);
+			}
+			else
+			{
+				results[i].script = scripts[i];
+				results[i].message = prelude_error;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (std::size_t i = 1; i < jobs; i++)
+		pool.emplace_back(worker);
+	worker();
+	for (auto & thread : pool)
+		thread.join();
+
+	return results;
+}
@@ -0,0 +1,63 @@
+/*! \file batch_runner.hpp
+Defines the batch mode of the plotscript CLI.
+
+A batch evaluates many script files on a pool of worker threads. Every
+script gets an interpreter of its own, so scripts cannot see each other's
+definitions, and its result or error is written next to it (or to an
+output directory) instead of the terminal.
+ */
+#ifndef BATCH_RUNNER_HPP
+#define BATCH_RUNNER_HPP
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "plot_renderer.hpp"
+
+/*! \struct BatchOptions
+\brief Settings shared by every script of a batch.
+ */
+struct BatchOptions
+{
+	/// number of worker threads, 0 uses the hardware concurrency
+	std::size_t jobs = 0;
+
+	/// directory receiving the results, empty writes them next to the scripts
+	std::string outputDir;
+
+	/// "png" or "svg" to also render every result, empty writes text only
+	std::string imageFormat;
+
+	/// image size used when rendering
+	RenderOptions render;
+
+	/// program evaluated before every script, usually the startup file
+	std::string prelude;
+};
+
+/*! \struct BatchResult
+\brief Outcome of one script of a batch.
+ */
+struct BatchResult
+{
+	std::string script;
+	bool ok = false;
+	std::string message;
+};
+
+/// read script paths from a manifest, one per line, skipping blank and ; comment lines
+std::vector<std::string> readManifest(std::istream & manifest);
+
+/// path a result of script is written to, extension includes the dot
+std::string batchOutputPath(const std::string & script, const std::string & outputDir, const std::string & extension);
+
+/*! Evaluate every script and write <name>.out on success or <name>.err on failure.
+\param scripts paths of the scripts to run
+\param options batch settings
+\return one result per script, in the order of scripts
+ */
+std::vector<BatchResult> runBatch(const std::vector<std::string> & scripts, const BatchOptions & options);
+
+#endif
@@ -0,0 +1,68 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "batch_runner.hpp"
+
+std::string readWhole(const std::string & path)
+{
+	std::ifstream in(path);
+	std::ostringstream text;
+	text << in.rdbuf();
+	return text.str();
+}
+
+TEST_CASE("Test reading a batch manifest", "[batch_runner]")
+{
+	std::istringstream manifest("first.pls\n\n; skipped\n  second.pls \r\n");
+
+	std::vector<std::string> scripts = readManifest(manifest);
+
+	REQUIRE(scripts.size() == 2);
+	REQUIRE(scripts[0] == "first.pls");
+	REQUIRE(scripts[1] == "second.pls");
+}
+
+TEST_CASE("Test batch output paths", "[batch_runner]")
+{
+	REQUIRE(batchOutputPath("dir/plot.pls", "", ".out") == "dir/plot.out");
+	REQUIRE(batchOutputPath("dir/plot.pls", "results", ".png") == "results/plot.png");
+	REQUIRE(batchOutputPath("a.b/plot", "", ".err") == "a.b/plot.err");
+}
+
+TEST_CASE("Test running a batch on several workers", "[batch_runner]")
+{
+	std::vector<std::string> scripts;
+	for (int i = 0; i < 6; i++)
+	{
+		std::string name = "batch_test_" + std::to_string(i) + ".pls";
+		std::ofstream(name) << ((i == 3) ? "(undefined-procedure 1)" : "(begin (define a " + std::to_string(i) + ") (+ a b))");
+		scripts.push_back(name);
+	}
+
+	BatchOptions options;
+	options.jobs = 3;
+	options.prelude = "(define b 10)";
+
+	std::vector<BatchResult> results = runBatch(scripts, options);
+
+	REQUIRE(results.size() == scripts.size());
+	for (int i = 0; i < 6; i++)
+	{
+		REQUIRE(results[i].script == scripts[i]);
+		REQUIRE(results[i].ok == (i != 3));
+
+		std::string out = batchOutputPath(scripts[i], "", ".out");
+		std::string err = batchOutputPath(scripts[i], "", ".err");
+		if (i == 3)
+			REQUIRE(readWhole(err).find("Error") == 0);
+		else
+			REQUIRE(readWhole(out) == "(" + std::to_string(i + 10) + ")\n");
+
+		std::remove(scripts[i].c_str());
+		std::remove(out.c_str());
+		std::remove(err.c_str());
+	}
+}
@@ -0,0 +1,71 @@
+/*! \file cancellation.hpp
+Defines the cancellation of a running evaluation.
+
+An evaluation checks its Cancellation as it goes (see
+Environment::checkCancellation) and stops with a SemanticError once another
+thread cancelled it or its time budget ran out. A check is a relaxed load of
+a flag; the clock is only read on every CANCELLATION_CLOCK_STRIDE-th check.
+ */
+#ifndef CANCELLATION_HPP
+#define CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+
+#include "semantic_error.hpp"
+
+/// checks between two readings of the clock
+const unsigned CANCELLATION_CLOCK_STRIDE = 256;
+
+/*! \class Cancellation
+\brief A flag and an optional deadline shared by an evaluation and the thread controlling it.
+ */
+class Cancellation
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	Cancellation() = default;
+	Cancellation(const Cancellation &) = delete;
+	Cancellation & operator=(const Cancellation &) = delete;
+
+	/// stop the evaluation at its next check, from any thread
+	void cancel() noexcept
+	{
+		m_cancelled.store(true, std::memory_order_relaxed);
+	}
+
+	bool cancelled() const noexcept
+	{
+		return m_cancelled.load(std::memory_order_relaxed);
+	}
+
+	/// stop the evaluation once budget has passed from now, before it starts
+	void setBudget(Clock::duration budget)
+	{
+		m_deadline = Clock::now() + budget;
+		m_limited = true;
+	}
+
+	/// throw if cancelled or past the deadline, from the evaluating thread only
+	void check()
+	{
+		if (cancelled())
+			throw SemanticError("Error: interpreter kernel interrupted");
+
+		if (m_limited && --m_countdown == 0)
+		{
+			m_countdown = CANCELLATION_CLOCK_STRIDE;
+			if (Clock::now() >= m_deadline)
+				throw SemanticError("Error: evaluation exceeded its time limit");
+		}
+	}
+
+private:
+	std::atomic<bool> m_cancelled{ false };
+	bool m_limited = false;
+	Clock::time_point m_deadline;
+	unsigned m_countdown = CANCELLATION_CLOCK_STRIDE;
+};
+
+#endif
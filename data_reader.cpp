@@ -0,0 +1,315 @@
+#include "data_reader.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DATA_READER_MMAP
+#endif
+
+#include "semantic_error.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// lines of a part of a CSV text, parsed on its own
+struct CsvChunk
+{
+	std::vector<double> values;
+	std::size_t columns = 0;
+	std::size_t lines = 0;
+
+	// line of the first row and first bad line, counted from the start of
+	// the chunk, 0 if there is none
+	std::size_t firstRow = 0;
+	std::size_t badLine = 0;
+	std::string problem;
+};
+
+bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// parse the number in [begin, end) ignoring surrounding blanks
+bool parseField(const char * begin, const char * end, double & value)
+{
+	while (begin != end && isBlank(*begin)) ++begin;
+	while (end != begin && isBlank(*(end - 1))) --end;
+
+	// strtod needs a terminated string, no number is longer than this
+	char field[64];
+	std::size_t length = end - begin;
+	if (length == 0 || length >= sizeof(field))
+		return false;
+
+	std::memcpy(field, begin, length);
+	field[length] = '\0';
+
+	char * parsed = nullptr;
+	value = std::strtod(field, &parsed);
+	return parsed == field + length;
+}
+
+// parse whole lines in [begin, end), header allows a leading non-numeric line
+void parseCsvChunk(const char * begin, const char * end, bool header, CsvChunk & chunk)
+{
+	std::vector<double> row;
+	const char * line = begin;
+
+	while (line < end)
+	{
+		const char * next = static_cast<const char *>(std::memchr(line, '\n', end - line));
+		const char * line_end = (next == nullptr) ? end : next;
+		++chunk.lines;
+
+		const char * c = line;
+		while (c != line_end && isBlank(*c)) ++c;
+
+		if (c != line_end)
+		{
+			row.clear();
+			bool numeric = true;
+			for (const char * field = line; numeric; )
+			{
+				const char * comma = static_cast<const char *>(std::memchr(field, ',', line_end - field));
+				const char * field_end = (comma == nullptr) ? line_end : comma;
+				double value;
+				numeric = parseField(field, field_end, value);
+				row.push_back(value);
+				if (comma == nullptr)
+					break;
+				field = comma + 1;
+			}
+
+			if (!numeric && header)
+			{
+				// a header line, skipped
+			}
+			else if (!numeric)
+			{
+				chunk.badLine = chunk.lines;
+				chunk.problem = "invalid number";
+				return;
+			}
+			else if (chunk.columns != 0 && row.size() != chunk.columns)
+			{
+				chunk.badLine = chunk.lines;
+				chunk.problem = "wrong number of columns";
+				return;
+			}
+			else
+			{
+				if (chunk.columns == 0)
+					chunk.firstRow = chunk.lines;
+				chunk.columns = row.size();
+				chunk.values.insert(chunk.values.end(), row.begin(), row.end());
+			}
+			header = false;
+		}
+
+		line = (next == nullptr) ? end : next + 1;
+	}
+}
+
+// little-endian bytes to a double, whatever the byte order of the host
+double littleEndianDouble(const char * bytes)
+{
+	std::uint64_t bits = 0;
+	for (int i = 7; i >= 0; i--)
+		bits = (bits << 8) | static_cast<unsigned char>(bytes[i]);
+
+	double value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// list holding a packed list for each column
+Expression columnsToList(std::vector<std::vector<double>> columns)
+{
+	Expression result(Atom("list"));
+	result.reserveTail(columns.size());
+	for (auto & column : columns)
+		result.pushback(Expression::makeNumbers(std::make_shared<const std::vector<double>>(std::move(column))));
+	return result;
+}
+
+// the file name argument of a reader procedure
+std::string fileArgument(const std::vector<Expression> & args, const std::string & procedure)
+{
+	if (args.empty() || !args[0].isHeadStringConstant() || !args[0].isTailEmpty())
+		throw SemanticError("Error in call to " + procedure + ": first argument is not a string");
+
+	return args[0].head().asStringConstant();
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+MappedFile::MappedFile(const std::string & filename)
+{
+#ifdef DATA_READER_MMAP
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw SemanticError("Error: Can't open file " + filename);
+
+	struct stat info;
+	bool empty = false;
+	if (::fstat(fd, &info) == 0)
+	{
+		empty = (info.st_size == 0);
+		void * mapped = empty ? MAP_FAILED : ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
+		{
+			m_data = static_cast<const char *>(mapped);
+			m_size = info.st_size;
+		}
+	}
+	::close(fd);
+
+	// an empty file cannot be mapped and needs no reading
+	if (m_data != nullptr || empty)
+		return;
+#endif
+
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+		throw SemanticError("Error: Can't open file " + filename);
+
+	m_copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	m_size = m_copy.size();
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef DATA_READER_MMAP
+	if (m_data != nullptr)
+		::munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
+
+const char * MappedFile::data() const noexcept
+{
+	return (m_data != nullptr) ? m_data : m_copy.data();
+}
+
+std::size_t MappedFile::size() const noexcept
+{
+	return m_size;
+}
+
+std::vector<std::vector<double>> parseCsv(const char * data, std::size_t size, std::size_t jobs)
+{
+	if (jobs == 0)
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	if (size < PARALLEL_PARSE_BYTES)
+		jobs = 1;
+
+	// split at line starts near equal offsets
+	std::vector<const char *> bounds(1, data);
+	const char * end = data + size;
+	for (std::size_t j = 1; j < jobs; j++)
+	{
+		const char * guess = std::max(bounds.back(), data + size * j / jobs);
+		const char * next = static_cast<const char *>(std::memchr(guess, '\n', end - guess));
+		if (next == nullptr)
+			break;
+		bounds.push_back(next + 1);
+	}
+	bounds.push_back(end);
+
+	std::vector<CsvChunk> chunks(bounds.size() - 1);
+	std::vector<std::thread> workers;
+	for (std::size_t c = 1; c < chunks.size(); c++)
+		workers.emplace_back(parseCsvChunk, bounds[c], bounds[c + 1], false, std::ref(chunks[c]));
+	parseCsvChunk(bounds[0], bounds[1], true, chunks[0]);
+	for (auto & worker : workers)
+		worker.join();
+
+	// report the first problem with its line in the whole file
+	std::size_t columns = 0;
+	std::size_t rows = 0;
+	std::size_t line = 0;
+	for (CsvChunk & chunk : chunks)
+	{
+		if (chunk.badLine == 0 && columns != 0 && chunk.columns != 0 && chunk.columns != columns)
+		{
+			// the chunk agrees with itself but not with the chunks before it
+			chunk.badLine = chunk.firstRow;
+			chunk.problem = "wrong number of columns";
+		}
+		if (chunk.badLine != 0)
+			throw SemanticError("Error: " + chunk.problem + " in line " + std::to_string(line + chunk.badLine));
+
+		if (chunk.columns != 0)
+			columns = chunk.columns;
+		rows += (chunk.columns == 0) ? 0 : chunk.values.size() / chunk.columns;
+		line += chunk.lines;
+	}
+
+	std::vector<std::vector<double>> result(columns);
+	for (auto & column : result)
+		column.reserve(rows);
+	for (const CsvChunk & chunk : chunks)
+		for (std::size_t i = 0; i < chunk.values.size(); i++)
+			result[i % columns].push_back(chunk.values[i]);
+
+	return result;
+}
+
+std::vector<std::vector<double>> readCsvFile(const std::string & filename, std::size_t jobs)
+{
+	MappedFile file(filename);
+	return parseCsv(file.data(), file.size(), jobs);
+}
+
+std::vector<std::vector<double>> readBinaryFile(const std::string & filename, std::size_t columns)
+{
+	MappedFile file(filename);
+
+	const std::size_t row_bytes = columns * sizeof(double);
+	if (columns == 0 || file.size() % row_bytes != 0)
+		throw SemanticError("Error: " + filename + " does not hold a whole number of rows");
+
+	const std::size_t rows = file.size() / row_bytes;
+	std::vector<std::vector<double>> result(columns, std::vector<double>(rows));
+	const char * bytes = file.data();
+	for (std::size_t r = 0; r < rows; r++)
+		for (std::size_t c = 0; c < columns; c++, bytes += sizeof(double))
+			result[c][r] = littleEndianDouble(bytes);
+
+	return result;
+}
+
+Expression readcsv(const std::vector<Expression> & args)
+{
+	if (args.size() != 1)
+		throw SemanticError("Error in call to read-csv: invalid number of arguments");
+
+	return columnsToList(readCsvFile(fileArgument(args, "read-csv")));
+}
+
+Expression readbinary(const std::vector<Expression> & args)
+{
+	if (args.size() != 2)
+		throw SemanticError("Error in call to read-binary: invalid number of arguments");
+
+	std::string filename = fileArgument(args, "read-binary");
+
+	if (!args[1].isHeadNumber() || args[1].head().asNumber() < 1 || args[1].head().asNumber() != std::floor(args[1].head().asNumber()))
+		throw SemanticError("Error in call to read-binary: second argument is not a positive integer");
+
+	return columnsToList(readBinaryFile(filename, static_cast<std::size_t>(args[1].head().asNumber())));
+}
@@ -0,0 +1,79 @@
+/*! \file data_reader.hpp
+Defines the readers loading numeric data files into packed lists.
+
+A data file is memory mapped and parsed in place, in chunks on several
+threads when it is large. Every column becomes a list made by
+Expression::makeNumbers, so no expression is created for a value until the
+list is iterated.
+ */
+#ifndef DATA_READER_HPP
+#define DATA_READER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "expression.hpp"
+
+/// files of at least this many bytes are parsed on several threads
+const std::size_t PARALLEL_PARSE_BYTES = 1 << 20;
+
+/*! \class MappedFile
+\brief Read-only view of the whole content of a file.
+
+The file is memory mapped where the platform supports it and read into
+memory otherwise.
+ */
+class MappedFile
+{
+public:
+
+	/// map filename, throws SemanticError if it cannot be opened
+	explicit MappedFile(const std::string & filename);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	const char * data() const noexcept;
+	std::size_t size() const noexcept;
+
+private:
+	const char * m_data = nullptr;
+	std::size_t m_size = 0;
+
+	// content when the file could not be mapped
+	std::vector<char> m_copy;
+};
+
+/*! Parse comma separated numbers into columns.
+
+Blank lines are skipped and a first line that is not numeric is taken as a
+header. Every other line must hold the same number of numeric fields.
+\param data the text, need not be null terminated
+\param size number of bytes of data
+\param jobs number of threads for large inputs, 0 uses the hardware concurrency
+\return one vector per column
+\throws SemanticError naming the first bad line
+ */
+std::vector<std::vector<double>> parseCsv(const char * data, std::size_t size, std::size_t jobs = 0);
+
+/// read a CSV file into columns, see parseCsv
+std::vector<std::vector<double>> readCsvFile(const std::string & filename, std::size_t jobs = 0);
+
+/*! Read a file of little-endian 64 bit floating point numbers.
+\param filename the file to read
+\param columns number of values in each row, stored one row after another
+\return one vector per column
+\throws SemanticError if the file cannot be read or holds a partial row
+ */
+std::vector<std::vector<double>> readBinaryFile(const std::string & filename, std::size_t columns);
+
+/// procedure read-csv: (read-csv "file") gives a list of the columns of file
+Expression readcsv(const std::vector<Expression> & args);
+
+/// procedure read-binary: (read-binary "file" columns) gives a list of the columns of file
+Expression readbinary(const std::vector<Expression> & args);
+
+#endif
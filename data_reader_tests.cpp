@@ -0,0 +1,109 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "data_reader.hpp"
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "test_helpers.hpp"
+
+TEST_CASE("Test parsing CSV text", "[data_reader]")
+{
+	std::string text = "x, y\r\n1,2\n\n  3.5 ,-4e1\n5,6";
+
+	std::vector<std::vector<double>> columns = parseCsv(text.data(), text.size());
+
+	REQUIRE(columns.size() == 2);
+	REQUIRE(columns[0] == std::vector<double>({ 1, 3.5, 5 }));
+	REQUIRE(columns[1] == std::vector<double>({ 2, -40, 6 }));
+
+	std::string bad = "1,2\n3,4\n5,x\n";
+	REQUIRE_THROWS_WITH(parseCsv(bad.data(), bad.size()), "Error: invalid number in line 3");
+
+	std::string ragged = "1,2\n\n3\n";
+	REQUIRE_THROWS_WITH(parseCsv(ragged.data(), ragged.size()), "Error: wrong number of columns in line 3");
+
+	REQUIRE(parseCsv("", 0).empty());
+}
+
+TEST_CASE("Test parsing large CSV text in chunks", "[data_reader]")
+{
+	std::ostringstream text;
+	text << "time,value\n";
+	const int rows = 80000;
+	for (int i = 0; i < rows; i++)
+		text << i << ", " << i * 0.03125 << ", " << (i % 7) - 3.5 << "\n";
+	std::string data = text.str();
+	REQUIRE(data.size() >= PARALLEL_PARSE_BYTES);
+
+	std::vector<std::vector<double>> serial = parseCsv(data.data(), data.size(), 1);
+	std::vector<std::vector<double>> parallel = parseCsv(data.data(), data.size(), 4);
+
+	REQUIRE(serial.size() == 3);
+	REQUIRE(serial[0].size() == rows);
+	REQUIRE(serial[0][rows - 1] == rows - 1);
+	REQUIRE(serial == parallel);
+
+	// the line of an error is counted over the whole text
+	std::string broken = data + "1,2\n";
+	REQUIRE_THROWS_WITH(parseCsv(broken.data(), broken.size(), 4), "Error: wrong number of columns in line " + std::to_string(rows + 2));
+}
+
+TEST_CASE("Test reading data files into lists", "[data_reader]")
+{
+	std::ofstream("data_reader_test.csv") << "x,y,z\n0,1,0\n1,3,0\n2,5,0\n";
+
+	Expression columns = evaluateProgram("(read-csv \"data_reader_test.csv\")");
+	REQUIRE(columns.tailSize() == 3);
+	REQUIRE(columns.tailAt(1).tailSize() == 3);
+	REQUIRE(columns.tailAt(1).tailAt(2) == Expression(Atom(5.)));
+
+	Expression points = evaluateProgram("(begin (define c (read-csv \"data_reader_test.csv\")) (zip (first c) (first (rest c))))");
+	REQUIRE(points.tailSize() == 3);
+	Expression point(Atom("list"));
+	point.pushback(Expression(Atom(2.)));
+	point.pushback(Expression(Atom(5.)));
+	REQUIRE(points.tailAt(2) == point);
+
+	{
+		const double values[] = { 1.5, -2, 3, 4.25, 5, 6 };
+		std::ofstream out("data_reader_test.bin", std::ios::binary);
+		for (double value : values)
+		{
+			unsigned char bytes[8];
+			std::uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			for (int i = 0; i < 8; i++, bits >>= 8)
+				bytes[i] = static_cast<unsigned char>(bits & 0xff);
+			out.write(reinterpret_cast<const char *>(bytes), 8);
+		}
+	}
+
+	std::vector<std::vector<double>> binary = readBinaryFile("data_reader_test.bin", 2);
+	REQUIRE(binary.size() == 2);
+	REQUIRE(binary[0] == std::vector<double>({ 1.5, 3, 5 }));
+	REQUIRE(binary[1] == std::vector<double>({ -2, 4.25, 6 }));
+	REQUIRE_THROWS_AS(readBinaryFile("data_reader_test.bin", 4), const SemanticError &);
+
+	Expression rest = evaluateProgram("(rest (first (read-binary \"data_reader_test.bin\" 2)))");
+	REQUIRE(rest.tailSize() == 2);
+	REQUIRE(rest.tailAt(0) == Expression(Atom(3.)));
+	REQUIRE(rest.tailFrom(1).tailAt(0) == Expression(Atom(5.)));
+
+	std::remove("data_reader_test.csv");
+	std::remove("data_reader_test.bin");
+
+	std::vector<std::string> bad = { "(read-csv \"data_reader_missing.csv\")",
+	                                 "(read-csv 1)",
+	                                 "(read-binary \"data_reader_test.bin\" 0)",
+	                                 "(zip (list 1 2) (list 1))",
+	                                 "(zip 1)" };
+	for (auto program : bad)
+	{
+		INFO(program);
+		REQUIRE_THROWS_AS(evaluateProgram(program), const SemanticError &);
+	}
+}
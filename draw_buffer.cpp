@@ -0,0 +1,259 @@
+#include "draw_buffer.hpp"
+
+#include <algorithm>
+
+#include "result_writer.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+void addPointCommand(const Expression & exp, DrawBuffer & buffer)
+{
+	double pointsize = exp.graphicSlot(SizeSlot);
+
+	if (pointsize < 0)
+	{
+		buffer.addError("diameter of at least one point is negative");
+		return;
+	}
+
+	if (exp.tailSize() != 2)
+	{
+		buffer.addError("point does not have two coordinates");
+		return;
+	}
+
+	double x = exp.tailConstBegin()->head().asNumber();
+	double y = (exp.tailConstEnd() - 1)->head().asNumber();
+
+	buffer.addPoint(x, y, pointsize);
+}
+
+void addLineCommand(const Expression & exp, DrawBuffer & buffer)
+{
+	double thickness_size = exp.graphicSlot(ThicknessSlot);
+
+	if (thickness_size < 0)
+	{
+		buffer.addError("thickness of at least a line is negative");
+		return;
+	}
+
+	if (exp.tailSize() != 2)
+	{
+		buffer.addError("line does not have two points");
+		return;
+	}
+
+	double coordinate[4] = { 0, 0, 0, 0 }; int i = 0;
+	auto point1 = exp.tailConstBegin();
+	auto point2 = exp.tailConstEnd() - 1;
+	for (auto a = point1->tailConstBegin(); a != point1->tailConstEnd() && i < 2; a++)
+	{
+		coordinate[i] = a->head().asNumber();
+		i++;
+	}
+	for (auto a = point2->tailConstBegin(); a != point2->tailConstEnd() && i < 4; a++)
+	{
+		coordinate[i] = a->head().asNumber();
+		i++;
+	}
+
+	buffer.addLine(coordinate[0], coordinate[1], coordinate[2], coordinate[3], thickness_size);
+}
+
+void addTextCommand(const Expression & exp, DrawBuffer & buffer)
+{
+	const Expression * position = exp.graphicPosition();
+
+	if (position == nullptr || position->graphicKind() != PointGraphic || position->tailSize() != 2)
+	{
+		buffer.addError("position of text is not a point");
+		return;
+	}
+
+	double x = position->tailConstBegin()->head().asNumber();
+	double y = (position->tailConstEnd() - 1)->head().asNumber();
+	double angle = exp.graphicSlot(TextRotationSlot);
+	double scale = exp.graphicSlot(TextScaleSlot);
+
+	if (scale < 1) scale = 1;
+
+	buffer.addText(x, y, angle, scale, exp.head().asStringConstant());
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+void DrawBounds::include(double x, double y)
+{
+	if (!valid)
+	{
+		xMin = xMax = x;
+		yMin = yMax = y;
+		valid = true;
+		return;
+	}
+	xMin = std::min(xMin, x);
+	xMax = std::max(xMax, x);
+	yMin = std::min(yMin, y);
+	yMax = std::max(yMax, y);
+}
+
+void DrawBuffer::addPoint(double x, double y, double size)
+{
+	DrawCommand command = { DrawCommand::PointKind, x, y, x, y, size, 0, 0 };
+	m_commands.push_back(command);
+}
+
+void DrawBuffer::addLine(double x1, double y1, double x2, double y2, double thickness)
+{
+	DrawCommand command = { DrawCommand::LineKind, x1, y1, x2, y2, thickness, 0, 0 };
+	m_commands.push_back(command);
+}
+
+void DrawBuffer::addText(double x, double y, double rotation, double scale, const std::string & text)
+{
+	DrawCommand command = { DrawCommand::TextKind, x, y, x, y, scale, rotation, addString(text) };
+	m_commands.push_back(command);
+}
+
+void DrawBuffer::addOutput(const std::string & message)
+{
+	DrawCommand command = { DrawCommand::OutputKind, 0, 0, 0, 0, 0, 0, addString(message) };
+	m_commands.push_back(command);
+}
+
+void DrawBuffer::addError(const std::string & message)
+{
+	DrawCommand command = { DrawCommand::ErrorKind, 0, 0, 0, 0, 0, 0, addString(message) };
+	m_commands.push_back(command);
+}
+
+void DrawBuffer::append(const DrawBuffer & other)
+{
+	std::size_t offset = m_strings.size();
+	m_strings.insert(m_strings.end(), other.m_strings.begin(), other.m_strings.end());
+
+	m_commands.reserve(m_commands.size() + other.m_commands.size());
+	for (auto command : other.m_commands)
+	{
+		if (command.kind == DrawCommand::TextKind || command.kind == DrawCommand::OutputKind
+			|| command.kind == DrawCommand::ErrorKind)
+			command.text += offset;
+		m_commands.push_back(command);
+	}
+}
+
+DrawBuffer DrawBuffer::subset(const std::vector<std::size_t> & indices) const
+{
+	DrawBuffer result;
+	result.m_commands.reserve(indices.size());
+	for (auto index : indices)
+	{
+		DrawCommand command = m_commands[index];
+		if (command.kind == DrawCommand::TextKind || command.kind == DrawCommand::OutputKind
+			|| command.kind == DrawCommand::ErrorKind)
+			command.text = result.addString(m_strings[command.text]);
+		result.m_commands.push_back(command);
+	}
+	return result;
+}
+
+void DrawBuffer::clear() noexcept
+{
+	m_commands.clear();
+	m_strings.clear();
+}
+
+std::size_t DrawBuffer::size() const noexcept
+{
+	return m_commands.size();
+}
+
+bool DrawBuffer::empty() const noexcept
+{
+	return m_commands.empty();
+}
+
+DrawBounds DrawBuffer::bounds() const
+{
+	DrawBounds result;
+	for (auto & command : m_commands)
+	{
+		if (command.kind == DrawCommand::PointKind || command.kind == DrawCommand::TextKind)
+		{
+			result.include(command.x1, command.y1);
+		}
+		else if (command.kind == DrawCommand::LineKind)
+		{
+			result.include(command.x1, command.y1);
+			result.include(command.x2, command.y2);
+		}
+	}
+	return result;
+}
+
+const DrawCommand & DrawBuffer::operator[](std::size_t index) const
+{
+	return m_commands[index];
+}
+
+const std::string & DrawBuffer::textOf(const DrawCommand & command) const
+{
+	return m_strings[command.text];
+}
+
+DrawBuffer::ConstIteratorType DrawBuffer::begin() const noexcept
+{
+	return m_commands.cbegin();
+}
+
+DrawBuffer::ConstIteratorType DrawBuffer::end() const noexcept
+{
+	return m_commands.cend();
+}
+
+std::size_t DrawBuffer::addString(const std::string & text)
+{
+	m_strings.push_back(text);
+	return m_strings.size() - 1;
+}
+
+void buildDrawBuffer(const Expression & exp, DrawBuffer & buffer)
+{
+	if (exp.isHeadSymbol() && exp.head().asSymbol() == "lambda")
+		return;
+
+	if (exp.head().isNone())
+	{
+		buffer.addError("NONE");
+		return;
+	}
+
+	GraphicKind kind = exp.graphicKind();
+
+	if (kind == PointGraphic)
+	{
+		addPointCommand(exp, buffer);
+	}
+	else if (kind == LineGraphic)
+	{
+		addLineCommand(exp, buffer);
+	}
+	else if (kind == TextGraphic)
+	{
+		addTextCommand(exp, buffer);
+	}
+	else if (exp.isHeadSymbol() && (exp.head().asSymbol() == "list") && (exp.propertySize() == 0))
+	{
+		for (auto a = exp.tailConstBegin(); a != exp.tailConstEnd(); a++)
+			buildDrawBuffer(*a, buffer);
+	}
+	else
+	{
+		buffer.addOutput(ResultWriter().format(exp));
+	}
+}
@@ -0,0 +1,130 @@
+/*! \file draw_buffer.hpp
+Defines the DrawBuffer type, a flat list of typed drawing commands.
+
+The notebook kernel translates an evaluated result into a DrawBuffer so the
+GUI thread only has to paint it, without walking the Expression tree.
+ */
+#ifndef DRAW_BUFFER_HPP
+#define DRAW_BUFFER_HPP
+
+#include <string>
+#include <vector>
+
+#include "expression.hpp"
+
+/*! \struct DrawCommand
+\brief A single drawing primitive with its numeric attributes.
+
+Coordinates are in scene units, exactly as stored in the graphics objects.
+ */
+struct DrawCommand
+{
+	/// the kind of primitive, Output and Error carry plain messages
+	enum Kind { PointKind, LineKind, TextKind, OutputKind, ErrorKind };
+
+	Kind kind;
+	double x1;        //< point center, line start or text center
+	double y1;
+	double x2;        //< line end
+	double y2;
+	double size;      //< point diameter, line thickness or text scale
+	double rotation;  //< text rotation in radians
+	std::size_t text; //< index into the string table (text, output, error)
+};
+
+/*! \struct DrawBounds
+\brief Axis aligned extent of the points and lines of a DrawBuffer.
+ */
+struct DrawBounds
+{
+	double xMin = 0;
+	double xMax = 0;
+	double yMin = 0;
+	double yMax = 0;
+	bool valid = false; //< false until a coordinate has been included
+
+	/// grow the bounds to contain (x,y)
+	void include(double x, double y);
+};
+
+/*! \class DrawBuffer
+\brief A flat, ordered sequence of DrawCommands plus their string table.
+
+This class provides value semantics.
+ */
+class DrawBuffer
+{
+public:
+
+	typedef std::vector<DrawCommand>::const_iterator ConstIteratorType;
+
+	/// append a point centered at (x,y) with diameter size
+	void addPoint(double x, double y, double size);
+
+	/// append a line from (x1,y1) to (x2,y2)
+	void addLine(double x1, double y1, double x2, double y2, double thickness);
+
+	/// append a text centered at (x,y), rotation is in radians
+	void addText(double x, double y, double rotation, double scale, const std::string & text);
+
+	/// append a plain (non graphical) result message
+	void addOutput(const std::string & message);
+
+	/// append an error message
+	void addError(const std::string & message);
+
+	/// append every command of another buffer
+	void append(const DrawBuffer & other);
+
+	/// copy of the commands at the given (ascending) indices
+	DrawBuffer subset(const std::vector<std::size_t> & indices) const;
+
+	/// remove all commands
+	void clear() noexcept;
+
+	/// number of commands in the buffer
+	std::size_t size() const noexcept;
+
+	/// true if the buffer holds no command
+	bool empty() const noexcept;
+
+	/// extent of all points and lines (texts only contribute their center)
+	DrawBounds bounds() const;
+
+	/// return the command at index
+	const DrawCommand & operator[](std::size_t index) const;
+
+	/// return the string attached to a text, output or error command
+	const std::string & textOf(const DrawCommand & command) const;
+
+	/// return a const-iterator to the first command
+	ConstIteratorType begin() const noexcept;
+
+	/// return a const-iterator past the last command
+	ConstIteratorType end() const noexcept;
+
+private:
+
+	// the commands, in the order they have to be painted
+	std::vector<DrawCommand> m_commands;
+
+	// strings referenced by text, output and error commands
+	std::vector<std::string> m_strings;
+
+	// helper to store a string and return its index
+	std::size_t addString(const std::string & text);
+};
+
+/*! \fn buildDrawBuffer
+\brief translate an evaluated result into draw commands
+
+Points, lines and texts (lists carrying an "object-name" property) become
+drawing primitives, property-less lists are walked recursively and any other
+value is rendered as a plain output message.
+
+\param exp the evaluated expression
+\param buffer the buffer the commands are appended to
+ */
+void buildDrawBuffer(const Expression & exp, DrawBuffer & buffer);
+
+#endif
@@ -0,0 +1,117 @@
+#include "catch.hpp"
+
+#include "draw_buffer.hpp"
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "test_helpers.hpp"
+
+DrawBuffer runDraw(const std::string & program)
+{
+	DrawBuffer buffer;
+	buildDrawBuffer(evaluateProgram(program), buffer);
+	return buffer;
+}
+
+int countKind(const DrawBuffer & buffer, DrawCommand::Kind kind)
+{
+	int count = 0;
+	for (auto & command : buffer)
+		if (command.kind == kind)
+			count++;
+	return count;
+}
+
+TEST_CASE("Test draw buffer of a plain value", "[draw_buffer]")
+{
+	DrawBuffer buffer = runDraw("(+ 1 2)");
+
+	REQUIRE(buffer.size() == 1);
+	REQUIRE(buffer[0].kind == DrawCommand::OutputKind);
+	REQUIRE(buffer.textOf(buffer[0]) == "(3)");
+}
+
+TEST_CASE("Test draw buffer of a lambda is empty", "[draw_buffer]")
+{
+	DrawBuffer buffer = runDraw("(lambda (x) (* 2 x))");
+
+	REQUIRE(buffer.empty());
+}
+
+TEST_CASE("Test draw buffer of graphic primitives", "[draw_buffer]")
+{
+	{
+		DrawBuffer buffer;
+		Expression point = makePoint(1, 2, 4);
+		buildDrawBuffer(point, buffer);
+
+		REQUIRE(buffer.size() == 1);
+		REQUIRE(buffer[0].kind == DrawCommand::PointKind);
+		REQUIRE(buffer[0].x1 == 1);
+		REQUIRE(buffer[0].y1 == 2);
+		REQUIRE(buffer[0].size == 4);
+	}
+
+	{
+		DrawBuffer buffer;
+		Expression line = makeLine(makePoint(0, 1, 0), makePoint(2, 3, 0));
+		buildDrawBuffer(line, buffer);
+
+		REQUIRE(buffer.size() == 1);
+		REQUIRE(buffer[0].kind == DrawCommand::LineKind);
+		REQUIRE(buffer[0].x1 == 0);
+		REQUIRE(buffer[0].y1 == 1);
+		REQUIRE(buffer[0].x2 == 2);
+		REQUIRE(buffer[0].y2 == 3);
+	}
+
+	{
+		DrawBuffer buffer = runDraw("(set-property \"size\" -1 (set-property \"object-name\" \"point\" (list 0 0)))");
+
+		REQUIRE(buffer.size() == 1);
+		REQUIRE(buffer[0].kind == DrawCommand::ErrorKind);
+	}
+}
+
+TEST_CASE("Test draw buffer of a discrete plot", "[draw_buffer]")
+{
+	std::string program = "(discrete-plot (list (list -1 -1) (list 1 1))"
+		"(list (list \"title\" \"The Title\")"
+		"(list \"abscissa-label\" \"X Label\")"
+		"(list \"ordinate-label\" \"Y Label\")))";
+
+	DrawBuffer buffer = runDraw(program);
+
+	// 8 lines + 2 points + 7 text = 17
+	REQUIRE(buffer.size() == 17);
+	REQUIRE(countKind(buffer, DrawCommand::LineKind) == 8);
+	REQUIRE(countKind(buffer, DrawCommand::PointKind) == 2);
+	REQUIRE(countKind(buffer, DrawCommand::TextKind) == 7);
+
+	bool foundTitle = false;
+	for (auto & command : buffer)
+		if (command.kind == DrawCommand::TextKind && buffer.textOf(command) == "The Title")
+		{
+			foundTitle = true;
+			REQUIRE(command.x1 == 0);
+			REQUIRE(command.y1 == -13);
+			REQUIRE(command.rotation == 0);
+		}
+	REQUIRE(foundTitle);
+}
+
+TEST_CASE("Test appending draw buffers", "[draw_buffer]")
+{
+	DrawBuffer first;
+	first.addText(0, 0, 0, 1, "first");
+
+	DrawBuffer second;
+	second.addText(1, 1, 0, 1, "second");
+	second.addError("oops");
+
+	first.append(second);
+
+	REQUIRE(first.size() == 3);
+	REQUIRE(first.textOf(first[0]) == "first");
+	REQUIRE(first.textOf(first[1]) == "second");
+	REQUIRE(first.textOf(first[2]) == "oops");
+}
@@ -2,9 +2,13 @@
 
 #include <cassert>
 #include <cmath>
+#include <limits>
 
 #include "environment.hpp"
+#include "data_reader.hpp"
+#include "plot_stream.hpp"
 #include "semantic_error.hpp"
+#include "serialization.hpp"
 
 
 /************************************************************************************************************************************
@@ -16,11 +20,13 @@ bool nargs_equal(const std::vector<Expression> & args, unsigned nargs) {
 	return args.size() == nargs;
 }
 
-std::unordered_map<std::string, double> checkAndScalePoints(Expression points)
+// check the points of a plot and find their bounds in a single pass
+PlotBounds checkAndScalePoints(Expression::ConstIteratorType begin, Expression::ConstIteratorType end)
 {
-	double xMax = -9999, xMin = 9999, yMax = -9999, yMin = 9999;
+	PlotBounds bounds;
+	bounds.xMax = -9999; bounds.xMin = 9999; bounds.yMax = -9999; bounds.yMin = 9999;
 
-	for (auto a = points.tailConstBegin(); a != points.tailConstEnd(); a++)
+	for (auto a = begin; a != end; a++)
 	{
 		if (!(a->tailSize() == 2))
 		{
@@ -30,9 +36,8 @@ std::unordered_map<std::string, double> checkAndScalePoints(Expression points)
 		{
 			throw SemanticError("Error in handle makeLollipopLine: arguments is not a point.");
 		}
-		Expression temp = *a;
-		Expression * first = temp.first_of_tail();
-		Expression * second = temp.tail();
+		const Expression * first = a->first_of_tail();
+		const Expression * second = a->tail();
 
 		if (!first->isHeadNumber() || !second->isHeadNumber())
 		{
@@ -41,35 +46,27 @@ std::unordered_map<std::string, double> checkAndScalePoints(Expression points)
 		double xCoordinate = first->head().asNumber();
 		double yCoordinate = second->head().asNumber();
 
-		xMax = std::max(xMax, xCoordinate);
-		xMin = std::min(xMin, xCoordinate);
-		yMax = std::max(yMax, yCoordinate);
-		yMin = std::min(yMin, yCoordinate);
+		bounds.xMax = std::max(bounds.xMax, xCoordinate);
+		bounds.xMin = std::min(bounds.xMin, xCoordinate);
+		bounds.yMax = std::max(bounds.yMax, yCoordinate);
+		bounds.yMin = std::min(bounds.yMin, yCoordinate);
 	}
-	std::unordered_map<std::string, double> result;
-	result.emplace("xMax", xMax);
-	result.emplace("xMin", xMin);
-	result.emplace("yMax", yMax);
-	result.emplace("yMin", yMin);
-	result.emplace("xMid", (xMax + xMin) / 2);
-	result.emplace("yMid", (yMax + yMin) / 2);
-	result.emplace("xScale", BOXSCALE / (xMax - xMin));
-	result.emplace("yScale", BOXSCALE / (yMax - yMin));
-	return result;
+	bounds.xScale = BOXSCALE / (bounds.xMax - bounds.xMin);
+	bounds.yScale = BOXSCALE / (bounds.yMax - bounds.yMin);
+	return bounds;
 }
 
 // get the scale for the text
-double getTextScale(Expression options)
+double getTextScale(const Expression & options)
 {
 	double default_scale = 1;
 
 	for (auto a = options.tailConstBegin(); a != options.tailConstEnd(); a++)
 	{
-		Expression temp = *a;
-		if (temp.first_of_tail()->isHeadStringConstant())
+		if (a->first_of_tail()->isHeadStringConstant())
 		{
-			if (temp.first_of_tail()->head().asStringConstant() == "text-scale" && temp.tail()->isHeadNumber())
-				return temp.tail()->head().asNumber();
+			if (a->first_of_tail()->head().asStringConstant() == "text-scale" && a->tail()->isHeadNumber())
+				return a->tail()->head().asNumber();
 		}
 	}
 	return default_scale;
@@ -78,11 +75,10 @@ double getTextScale(Expression options)
 // make a point with default property given x and y location
 Expression makePoint(double x, double y, double point_size)
 {
-	Atom point_obj = Atom("point"); point_obj.setStringType();
-
 	Expression point(Atom("list"));
-	point.add_property("object-name", point_obj);
-	point.add_property("size", Atom(point_size));
+	point.reserveTail(2);
+	point.setGraphicKind(PointGraphic);
+	point.setGraphicSlot(SizeSlot, point_size);
 	point.append(x);
 	point.append(y);
 
@@ -90,13 +86,12 @@ Expression makePoint(double x, double y, double point_size)
 }
 
 // make a line with default property given 2 points
-Expression makeLine(Expression point1, Expression point2)
+Expression makeLine(const Expression & point1, const Expression & point2)
 {
-	Atom line_name = Atom("line"); line_name.setStringType();
-
 	Expression line(Atom("list"));
-	line.add_property("object-name", line_name);
-	line.add_property("thickness", Expression(Atom(0)));
+	line.reserveTail(2);
+	line.setGraphicKind(LineGraphic);
+	line.setGraphicSlot(ThicknessSlot, 0);
 	line.pushback(point1);
 	line.pushback(point2);
 
@@ -106,25 +101,24 @@ Expression makeLine(Expression point1, Expression point2)
 // make text with default property given text, position, scale, and rotation
 Expression makeText(std::string text_message, Expression position, double scale, double rotaion)
 {
-	Atom object_type("text"); object_type.setStringType();
 	Atom object_message(text_message); object_message.setStringType();
 
 	Expression text_object(object_message);
-	text_object.add_property("object-name", object_type);
-	text_object.add_property("position", position);
-	text_object.add_property("text-scale", Expression(Atom(scale)));
-	text_object.add_property("text-rotation", Expression(Atom(rotaion)));
+	text_object.setGraphicKind(TextGraphic);
+	text_object.setGraphicPosition(position);
+	text_object.setGraphicSlot(TextScaleSlot, scale);
+	text_object.setGraphicSlot(TextRotationSlot, rotaion);
 	return text_object;
 }
 
 // get data for the border Line
-void get_borderLine(std::unordered_map<std::string, double> data, Expression & result)
+void get_borderLine(const PlotBounds & bounds, Expression & result)
 {
-	double xMax_S = data.at("xScale") * data.at("xMax");
-	double xMin_S = data.at("xScale") * data.at("xMin");
+	double xMax_S = bounds.right();
+	double xMin_S = bounds.left();
 
-	double yMax_S = -1 * data.at("yScale") * data.at("yMax");
-	double yMin_S = -1 * data.at("yScale") * data.at("yMin");
+	double yMax_S = bounds.top();
+	double yMin_S = bounds.bottom();
 
 	double yZero = 0;
 	double xZero = 0;
@@ -166,14 +160,14 @@ void get_borderLine(std::unordered_map<std::string, double> data, Expression & r
 }
 
 // create a lolipop given a point.
-void makeLollipopLine(Expression point, Expression & result, std::unordered_map<std::string, double> data)
+void makeLollipopLine(const Expression & point, Expression & result, const PlotBounds & bounds)
 {
-	double yMax_S = -1 * data.at("yScale") * data.at("yMax");
-	double yMin_S = -1 * data.at("yScale") * data.at("yMin");
+	double yMax_S = bounds.top();
+	double yMin_S = bounds.bottom();
 
-	double xCoordinate = point.first_of_tail()->head().asNumber() * data.at("xScale");
-	double yCoordinate = -1 * point.tail()->head().asNumber() * data.at("yScale");
-	double yZero = -1 * 0 * data.at("yScale");
+	double xCoordinate = point.first_of_tail()->head().asNumber() * bounds.xScale;
+	double yCoordinate = -1 * point.tail()->head().asNumber() * bounds.yScale;
+	double yZero = -1 * 0 * bounds.yScale;
 
 	double bot_point = 0;
 	if (yZero < yMin_S && yZero > yMax_S)
@@ -199,7 +193,7 @@ void makeLollipopLine(Expression point, Expression & result, std::unordered_map<
 }
 
 // checking to make sure all the list are correct.
-void checkAndMakeOptionList(Expression option, Expression & result, double text_scale, std::unordered_map<std::string, double> data)
+void checkAndMakeOptionList(const Expression & option, Expression & result, double text_scale, const PlotBounds & bounds)
 {
 
 	if (!(option.tailSize() == 2))
@@ -220,11 +214,11 @@ void checkAndMakeOptionList(Expression option, Expression & result, double text_
 	}
 
 
-	double xMax_S = data.at("xScale") * data.at("xMax");
-	double xMin_S = data.at("xScale") * data.at("xMin");
+	double xMax_S = bounds.right();
+	double xMin_S = bounds.left();
 
-	double yMax_S = -1 * data.at("yScale") * data.at("yMax");
-	double yMin_S = -1 * data.at("yScale") * data.at("yMin");
+	double yMax_S = bounds.top();
+	double yMin_S = bounds.bottom();
 	double yMid_S = (yMax_S + yMin_S) / 2;
 	double xMid_S = (xMax_S + xMin_S) / 2;
 
@@ -252,19 +246,19 @@ void checkAndMakeOptionList(Expression option, Expression & result, double text_
 	result.pushback(Object);
 }
 
-void addAlAuOlOu(std::unordered_map<std::string, double> data, Expression & result, double text_scale)
+void addAlAuOlOu(const PlotBounds & bounds, Expression & result, double text_scale)
 {
 
-	double xMin = data.at("xMin");
-	double xMax = data.at("xMax");
-	double yMin = data.at("yMin");
-	double yMax = data.at("yMax");
+	double xMin = bounds.xMin;
+	double xMax = bounds.xMax;
+	double yMin = bounds.yMin;
+	double yMax = bounds.yMax;
 
-	double xMax_S = data.at("xScale") * data.at("xMax");
-	double xMin_S = data.at("xScale") * data.at("xMin");
+	double xMax_S = bounds.right();
+	double xMin_S = bounds.left();
 
-	double yMax_S = -1 * data.at("yScale") * data.at("yMax");
-	double yMin_S = -1 * data.at("yScale") * data.at("yMin");
+	double yMax_S = bounds.top();
+	double yMin_S = bounds.bottom();
 
 	std::ostringstream out1;
 	out1.precision(2);
@@ -298,254 +292,145 @@ Expression default_proc(const std::vector<Expression> & args) {
 	return Expression();
 };
 
-ComplexNumber addcomplex(const std::vector <Expression> &args)
+// true if any argument is complex, used to pick the error message of the arithmetic procedures
+bool anycomplex(const std::vector<Expression> & args)
 {
-	ComplexNumber result(0, 0);
 	for (auto & a : args)
-	{// check all aruments are numbers or complex, while adding
-		if (a.isHeadNumber())
-		{
-			result.real(std::real(result) + a.head().asNumber());
-		}
-		else if (a.isHeadComplex())
-		{
-			// add both real and imag
-			result.real(std::real(result) + a.head().asRealNumber());
-			result.imag(std::imag(result) + a.head().asImaginaryNumber());
-		}
-		else
-		{
-			throw SemanticError("Error in call to add complex numbers: argument is not a number or complex number");
-		}
-	}
-	return result;
+		if (a.isHeadComplex())
+			return true;
+	return false;
 }
 
+// sums in one pass, switching to complex accumulation at the first complex argument
 Expression add(const std::vector<Expression> & args) {
 
-	
 	double result = 0;
-
+	ComplexNumber complexresult;
 	bool containcomplex = false;
+
 	for (auto & a : args) {
-		if (a.isHeadComplex())
-			containcomplex = true;
-	}
-	if (containcomplex)
-	{
-		return Expression(addcomplex(args));
-	}
-	else
-	{
-		for (auto & a : args) {
-			// check all aruments are numbers, while adding
-			if (a.isHeadNumber()) {
-				result += a.head().asNumber();
-			}
-			else {
-				throw SemanticError("Error in call to add, argument not a number");
+		const Atom & value = a.head();
+		if (value.isNumber()) {
+			if (containcomplex)
+				complexresult += value.asNumber();
+			else
+				result += value.asNumber();
+		}
+		else if (value.isComplexNumber()) {
+			if (!containcomplex) {
+				complexresult = ComplexNumber(result, 0);
+				containcomplex = true;
 			}
+			complexresult += value.asComplexNumber();
 		}
-	}
-	return Expression(result);
-};
-
-
-ComplexNumber mulcomplex(const std::vector <Expression> &args)
-{
-	ComplexNumber result;
-	bool setfirstcomplex = false;
-	double realnumber = 1;
-	for (auto & a : args)
-	{// check all aruments are numbers or complex, while multiplying
-		if (a.isHeadNumber())
-		{
-			realnumber = realnumber * a.head().asNumber();
+		else if (containcomplex || anycomplex(args)) {
+			throw SemanticError("Error in call to add complex numbers: argument is not a number or complex number");
 		}
-		else if (a.isHeadComplex())
-		{
-			if (!setfirstcomplex)
-			{
-				result = a.head().asComplexNumber();
-				setfirstcomplex = true;
-			}
-			else
-				result = result * a.head().asComplexNumber();
+		else {
+			throw SemanticError("Error in call to add, argument not a number");
 		}
-		else
-			throw SemanticError("Error in call to multiply with complex numbers: argument not a number or complex number");
 	}
-	result.imag(std::imag(result) * realnumber);
-	result.real(std::real(result) * realnumber);
-	return result;
-}
-
-Expression mul(const std::vector<Expression> & args) {
 
-	// check all aruments are numbers, while multiplying
-	double result = 1;
-
-	bool containcomplex = false;
-	for (auto & a : args) {
-		if (a.isHeadComplex())
-			containcomplex = true;
-	}
 	if (containcomplex)
-	{
-		return Expression(mulcomplex(args));
-	}
-	else
-	{
-		for (auto & a : args) {
-			if (a.isHeadNumber()) {
-				result *= a.head().asNumber();
-			}
-			else {
-				throw SemanticError("Error in call to mul, argument not a number");
-			}
-		}
-	}
+		return Expression(complexresult);
 	return Expression(result);
 };
 
-ComplexNumber subnegcomplex(const std::vector<Expression> & args)
-{
-	ComplexNumber result(0, 0);
-	if (nargs_equal(args, 1))
-	{
-			result.imag(-(args[0].head().asImaginaryNumber()));
-			result.real(-(args[0].head().asRealNumber()));
-	}
-	else if (nargs_equal(args, 2))
-	{
-		if (args[0].isHeadComplex() && args[1].isHeadComplex())
-		{
-			result.imag(args[0].head().asImaginaryNumber() - args[1].head().asImaginaryNumber());
-			result.real(args[0].head().asRealNumber() - args[1].head().asRealNumber());
-		}
-		else if (args[0].isHeadComplex() && args[1].isHeadNumber())
-		{
-			result.real(args[0].head().asRealNumber() - args[1].head().asNumber());
-			result.imag(args[0].head().asImaginaryNumber());
-		}
-		else if (args[0].isHeadNumber() && args[1].isHeadComplex())
-		{
-			result.real(args[0].head().asNumber() - args[1].head().asRealNumber());
-			result.imag(0-args[1].head().asImaginaryNumber());
-		}
-		else 
-			throw SemanticError("Error in call to subneg with complex numbers: invalid argument.");
-	}
-	else
-		throw SemanticError("Error in call to subtraction or negation: invalid number of arguments.");
-
-	return result;
-
-}
-
-Expression subneg(const std::vector<Expression> & args) {
-
-	double result = 0;
+// multiplies in one pass, real factors are kept apart and applied to the complex product at the end
+Expression mul(const std::vector<Expression> & args) {
 
+	double result = 1;
+	ComplexNumber complexresult;
 	bool containcomplex = false;
+
 	for (auto & a : args) {
-		if (a.isHeadComplex())
+		const Atom & value = a.head();
+		if (value.isNumber()) {
+			result *= value.asNumber();
+		}
+		else if (value.isComplexNumber()) {
+			if (containcomplex)
+				complexresult *= value.asComplexNumber();
+			else
+				complexresult = value.asComplexNumber();
 			containcomplex = true;
-	}
-	if (containcomplex)
-		return Expression(subnegcomplex(args));
-
-	else
-	{
-		// preconditions
-		if (nargs_equal(args, 1)) {
-			if (args[0].isHeadNumber()) {
-				result = -args[0].head().asNumber();
-			}
-			else {
-				throw SemanticError("Error in call to negate: invalid argument.");
-			}
 		}
-		else if (nargs_equal(args, 2)) {
-			if ((args[0].isHeadNumber()) && (args[1].isHeadNumber())) {
-				result = args[0].head().asNumber() - args[1].head().asNumber();
-			}
-			else {
-				throw SemanticError("Error in call to subtraction: invalid argument.");
-			}
+		else if (containcomplex || anycomplex(args)) {
+			throw SemanticError("Error in call to multiply with complex numbers: argument not a number or complex number");
 		}
 		else {
-			throw SemanticError("Error in call to subtraction or negation: invalid number of arguments.");
+			throw SemanticError("Error in call to mul, argument not a number");
 		}
 	}
+
+	if (containcomplex)
+		return Expression(complexresult * result);
 	return Expression(result);
 };
 
+Expression subneg(const std::vector<Expression> & args) {
 
-ComplexNumber divcomplex(const std::vector<Expression> & args)
-{
-	ComplexNumber result(0, 0);
-
-	if (nargs_equal(args, 2))
-	{
-		if (args[0].isHeadComplex() && args[1].isHeadComplex())
-		{
-			result = args[0].head().asComplexNumber() / args[1].head().asComplexNumber();
-		}
-		else if (args[0].isHeadComplex() && args[1].isHeadNumber())
-		{
-			result = args[0].head().asComplexNumber() / args[1].head().asNumber();
-		}
-		else if (args[0].isHeadNumber() && args[1].isHeadComplex())
-		{
-			result = args[0].head().asNumber() / args[1].head().asComplexNumber();
-		}
-		else
-			throw SemanticError("Error in call to division with complex numbers: invalid argument.");
+	if (nargs_equal(args, 1)) {
+		const Atom & value = args[0].head();
+		if (value.isNumber())
+			return Expression(-value.asNumber());
+		if (value.isComplexNumber())
+			return Expression(-value.asComplexNumber());
+		throw SemanticError("Error in call to negate: invalid argument.");
 	}
-	else if (nargs_equal(args, 1))
-	{
-		result = 1.0 / args[0].head().asComplexNumber();
-	}
-	else
-		throw SemanticError("Error in call to division with complexx numbers: invalid number of arguments.");
-	return result;
-}
 
-Expression div(const std::vector<Expression> & args) {
-
-	double result = 0;
-	bool containcomplex = false;
-
-	for (auto & a : args) {
-		if (a.isHeadComplex())
-			containcomplex = true;
-	}
-	if (containcomplex)
-		return Expression(divcomplex(args));
-	else
-	{
-		if (nargs_equal(args, 2)) {
+	if (!nargs_equal(args, 2))
+		throw SemanticError("Error in call to subtraction or negation: invalid number of arguments.");
 
-			if (!(args[0].isHeadNumber() && args[1].isHeadNumber())) {
-				throw SemanticError("Error in call to division: invalid argument.");
-			}
-				result = args[0].head().asNumber() / args[1].head().asNumber();
-		}
+	const Atom & left = args[0].head();
+	const Atom & right = args[1].head();
+
+	if (left.isNumber() && right.isNumber())
+		return Expression(left.asNumber() - right.asNumber());
+	if (left.isComplexNumber() && right.isComplexNumber())
+		return Expression(left.asComplexNumber() - right.asComplexNumber());
+	if (left.isComplexNumber() && right.isNumber())
+		return Expression(left.asComplexNumber() - right.asNumber());
+	if (left.isNumber() && right.isComplexNumber())
+		return Expression(ComplexNumber(left.asNumber() - right.asRealNumber(), 0 - right.asImaginaryNumber()));
+
+	if (left.isComplexNumber() || right.isComplexNumber())
+		throw SemanticError("Error in call to subneg with complex numbers: invalid argument.");
+	throw SemanticError("Error in call to subtraction: invalid argument.");
+};
 
-		else if (nargs_equal(args, 1))
-		{
-			if (!(args[0].isHeadNumber()))
-				throw SemanticError("Error in call to division: invalid argument.");
+Expression div(const std::vector<Expression> & args) {
 
-			result = 1.0 / args[0].head().asNumber();
-		}
+	if (nargs_equal(args, 1)) {
+		const Atom & value = args[0].head();
+		if (value.isNumber())
+			return Expression(1.0 / value.asNumber());
+		if (value.isComplexNumber())
+			return Expression(1.0 / value.asComplexNumber());
+		throw SemanticError("Error in call to division: invalid argument.");
+	}
 
-		else {
-			throw SemanticError("Error in call to division: invalid number of arguments.");
-		}
+	if (!nargs_equal(args, 2)) {
+		if (anycomplex(args))
+			throw SemanticError("Error in call to division with complexx numbers: invalid number of arguments.");
+		throw SemanticError("Error in call to division: invalid number of arguments.");
 	}
-	return Expression(result);
+
+	const Atom & left = args[0].head();
+	const Atom & right = args[1].head();
+
+	if (left.isNumber() && right.isNumber())
+		return Expression(left.asNumber() / right.asNumber());
+	if (left.isComplexNumber() && right.isComplexNumber())
+		return Expression(left.asComplexNumber() / right.asComplexNumber());
+	if (left.isComplexNumber() && right.isNumber())
+		return Expression(left.asComplexNumber() / right.asNumber());
+	if (left.isNumber() && right.isComplexNumber())
+		return Expression(left.asNumber() / right.asComplexNumber());
+
+	if (left.isComplexNumber() || right.isComplexNumber())
+		throw SemanticError("Error in call to division with complex numbers: invalid argument.");
+	throw SemanticError("Error in call to division: invalid argument.");
 };
 
 const double PI = std::atan2(0, -1);
@@ -724,6 +609,61 @@ Expression conjugate(const std::vector<Expression> &args)
 	return Expression(std::conj(args[0].head().asComplexNumber()));
 }
 
+Expression minimum(const std::vector<Expression> &args)
+{
+	if (args.empty())
+		throw SemanticError("Error in call to min : no arguments");
+
+	double result = 0;
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		if (!args[i].head().isNumber())
+			throw SemanticError("Error in call to min : argument is not a number");
+		if (i == 0 || args[i].head().asNumber() < result)
+			result = args[i].head().asNumber();
+	}
+
+	return Expression(result);
+}
+
+Expression maximum(const std::vector<Expression> &args)
+{
+	if (args.empty())
+		throw SemanticError("Error in call to max : no arguments");
+
+	double result = 0;
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		if (!args[i].head().isNumber())
+			throw SemanticError("Error in call to max : argument is not a number");
+		if (i == 0 || args[i].head().asNumber() > result)
+			result = args[i].head().asNumber();
+	}
+
+	return Expression(result);
+}
+
+// comparisons give 1 or 0, the predicates filter expects
+Expression lessthan(const std::vector<Expression> &args)
+{
+	if (!nargs_equal(args, 2))
+		throw SemanticError("Error in call to < : invalid number of arguments");
+
+	if (!args[0].head().isNumber() || !args[1].head().isNumber())
+		throw SemanticError("Error in call to < : argument is not a number");
+
+	return Expression(args[0].head().asNumber() < args[1].head().asNumber() ? 1.0 : 0.0);
+}
+
+Expression greaterthan(const std::vector<Expression> &args)
+{
+	if (!nargs_equal(args, 2))
+		throw SemanticError("Error in call to > : invalid number of arguments");
+
+	if (!args[0].head().isNumber() || !args[1].head().isNumber())
+		throw SemanticError("Error in call to > : argument is not a number");
+
+	return Expression(args[0].head().asNumber() > args[1].head().asNumber() ? 1.0 : 0.0);
+}
+
 Environment::Environment() {
 
 	reset();
@@ -732,14 +672,14 @@ Environment::Environment() {
 bool Environment::is_known(const Atom & sym) const {
 	if (!sym.isSymbol()) return false;
 
-	return envmap.find(sym.asSymbol()) != envmap.end();
+	return lookup(sym.asSymbol()) != nullptr;
 }
 
 bool Environment::is_exp(const Atom & sym) const {
 	if (!sym.isSymbol()) return false;
 
-	auto result = envmap.find(sym.asSymbol());
-	return (result != envmap.end()) && (result->second.type == ExpressionType);
+	const EnvResult * result = lookup(sym.asSymbol());
+	return (result != nullptr) && (result->type == ExpressionType);
 }
 
 Expression Environment::get_exp(const Atom & sym) const {
@@ -747,9 +687,9 @@ Expression Environment::get_exp(const Atom & sym) const {
 	Expression exp;
 
 	if (sym.isSymbol()) {
-		auto result = envmap.find(sym.asSymbol());
-		if ((result != envmap.end()) && (result->second.type == ExpressionType)) {
-			exp = result->second.exp;
+		const EnvResult * result = lookup(sym.asSymbol());
+		if ((result != nullptr) && (result->type == ExpressionType)) {
+			exp = result->exp;
 		}
 	}
 
@@ -761,9 +701,9 @@ Expression Environment::get_UserDefineProc(const Atom & sym) const {
 	Expression exp;
 
 	if (sym.isSymbol()) {
-		auto result = envmap.find(sym.asSymbol());
-		if ((result != envmap.end()) && ((result->second.exp.head().asSymbol() == "lambda"))) {
-			exp = result->second.exp;
+		const EnvResult * result = lookup(sym.asSymbol());
+		if ((result != nullptr) && ((result->exp.head().asSymbol() == "lambda"))) {
+			exp = result->exp;
 		}
 	}
 	return exp;
@@ -780,13 +720,16 @@ void Environment::add_exp(const Atom & sym, const Expression & exp) {
 		throw SemanticError("Attempt to overwrite symbol in environemnt");
 	}
 
-	auto result = envmap.find(sym.asSymbol());
-	// check to see expression is already there
-	if ((result != envmap.end()) && (result->second.type == ExpressionType))
-		result->second.exp = exp;
-	else 
-		envmap.emplace(sym.asSymbol(), EnvResult(ExpressionType, exp));
+	std::string name = sym.asSymbol();
+	if (name == "pi" || name == "e" || name == "I")
+		constantsRebound = true;
 
+	// bindings of a shared frame are never modified, they are shadowed in a new frame on top
+	if (frame.use_count() > 1)
+		pushFrame();
+	EnvResult & binding = frame->symbols[sym.asSymbol()];
+	binding = EnvResult(ExpressionType, exp);
+	binding.local = procedureScope;
 }
 
 Expression Environment::make_list(const Expression & exp)
@@ -815,15 +758,16 @@ Expression Environment::make_list(const Expression & exp)
 bool Environment::is_proc(const Atom & sym) const {
 	if (!sym.isSymbol()) return false;
 
-	auto result = envmap.find(sym.asSymbol());
-	return (result != envmap.end()) && (result->second.type == ProcedureType);
+	// procedures are never defined by a program, so this is not a read
+	const EnvResult * result = find(sym.asSymbol());
+	return (result != nullptr) && (result->type == ProcedureType);
 }
 
 bool Environment::is_userDefine(const Atom & sym) const {
 	if (!sym.isSymbol()) return false;
 
-	auto result = envmap.find(sym.asSymbol());
-	return (result != envmap.end()) && (result->second.exp.head().asSymbol() == "lambda");
+	const EnvResult * result = lookup(sym.asSymbol());
+	return (result != nullptr) && (result->exp.head().asSymbol() == "lambda");
 }
 
 Procedure Environment::get_proc(const Atom & sym) const {
@@ -831,9 +775,9 @@ Procedure Environment::get_proc(const Atom & sym) const {
 	//Procedure proc = default_proc;
 
 	if (sym.isSymbol()) {
-		auto result = envmap.find(sym.asSymbol());
-		if ((result != envmap.end()) && (result->second.type == ProcedureType)) {
-			return result->second.proc;
+		const EnvResult * result = lookup(sym.asSymbol());
+		if ((result != nullptr) && (result->type == ProcedureType)) {
+			return result->proc;
 		}
 	}
 
@@ -860,7 +804,7 @@ Expression firstinlist(const std::vector<Expression> &args)
 	if (args[0].isTailEmpty())
 		throw SemanticError("Error: argument to first is an empty list");
 
-	return  *args[0].tailConstBegin();
+	return args[0].tailAt(0);
 }
 
 Expression restoflist(const std::vector<Expression> &args)
@@ -876,9 +820,7 @@ Expression restoflist(const std::vector<Expression> &args)
 		throw SemanticError("Error: argument to rest is an empty list");
 
 	if (args[0].tailSize() > 2)
-		for (auto a = args[0].tailConstBegin(); a != args[0].tailConstEnd(); a++)
-			if (a != args[0].tailConstBegin())
-				result.pushback(*a);
+		result = args[0].tailFrom(1);
 
 	return result;
 }
@@ -892,9 +834,7 @@ Expression listsize(const std::vector<Expression> &args)
 	if (args[0].head().asSymbol() != "list")
 		throw SemanticError("Error: argument to length is not a list");
 
-	if (!args[0].isTailEmpty())
-		for (auto a = args[0].tailConstBegin(); a != args[0].tailConstEnd();a++)
-			result += 1;
+	result = args[0].tailSize();
 
 	return Expression(result);
 }
@@ -934,6 +874,35 @@ Expression joinlist(const std::vector<Expression> &args)
 	return result;
 }
 
+// element k of the result lists the elements k of the arguments
+Expression ziplists(const std::vector<Expression> &args)
+{
+	if (args.empty())
+		throw SemanticError("Error in call to zip: invalid number of arguments.");
+
+	for (const Expression & list : args)
+	{
+		if (list.head().asSymbol() != "list")
+			throw SemanticError("Error: argument to zip not a list");
+		if (list.tailSize() != args[0].tailSize())
+			throw SemanticError("Error: arguments to zip differ in length");
+	}
+
+	Expression result(Atom("list"));
+	result.reserveTail(args[0].tailSize());
+
+	for (int k = 0; k < args[0].tailSize(); k++)
+	{
+		Expression row(Atom("list"));
+		row.reserveTail(args.size());
+		for (const Expression & list : args)
+			row.pushback(list.tailAt(k));
+		result.pushback(row);
+	}
+
+	return result;
+}
+
 Expression rangelist(const std::vector<Expression> &args)
 {
 	if (!nargs_equal(args, 3))
@@ -949,11 +918,22 @@ Expression rangelist(const std::vector<Expression> &args)
 	if (args[2].head().asNumber() <= 0 )
 		throw SemanticError("Error: negative or zero increment in range");
 
-	Expression result(Atom("list"));
-	for (double i = args[0].head().asNumber(); i <= args[1].head().asNumber(); i += args[2].head().asNumber())
-		result.pushback(Expression(i));
+	// every k with begin + k * step <= end, computed without accumulating the step
+	double begin = args[0].head().asNumber();
+	double end = args[1].head().asNumber();
+	double step = args[2].head().asNumber();
 
-	return result;
+	double last = std::floor((end - begin) / step);
+	if (!(last < std::numeric_limits<int>::max()))
+		throw SemanticError("Error: too many elements in range");
+
+	std::size_t count = static_cast<std::size_t>(last) + 1;
+	while (begin + count * step <= end)
+		count++;
+	while (count > 1 && begin + (count - 1) * step > end)
+		count--;
+
+	return Expression::makeSequence(begin, step, count);
 }
 
 Expression discreteplot(const std::vector<Expression> &args)
@@ -962,8 +942,8 @@ Expression discreteplot(const std::vector<Expression> &args)
 	{
 		throw SemanticError("Error in handle discrete plot: invalid number of arguments.");
 	}
-	Expression data_list = args[0];
-	Expression option_list = args[1];
+	const Expression & data_list = args[0];
+	const Expression & option_list = args[1];
 
 	if (data_list.head().asSymbol() != "list")
 	{
@@ -977,23 +957,30 @@ Expression discreteplot(const std::vector<Expression> &args)
 	{
 		throw SemanticError("Error in handle discrete plot: second argument has more than 4 tails.");
 	}
-	Expression result(Atom("list"));
+	PlotBounds bounds = checkAndScalePoints(data_list.tailConstBegin(), data_list.tailConstEnd());
 
-	std::unordered_map<std::string, double> data_prop = checkAndScalePoints(data_list);
+	// a point and a stem for each datum, then at most 6 border lines, 3 options and 4 labels
+	Expression result(Atom("list"));
+	result.reserveTail(2 * data_list.tailSize() + 13);
 
+	// a notebook kernel shows the stems while the rest are made
 	for (auto a = data_list.tailConstBegin(); a != data_list.tailConstEnd(); a++)
 	{
-		makeLollipopLine(*a, result, data_prop);
+		std::size_t made = result.tailSize();
+		makeLollipopLine(*a, result, bounds);
+		streamPrimitives(result, made);
 	}
-	get_borderLine(data_prop, result);
+	std::size_t stems = result.tailSize();
+	get_borderLine(bounds, result);
 
 	double text_scale = getTextScale(option_list);
 
 	for (auto a = option_list.tailConstBegin(); a != option_list.tailConstEnd(); a++)
 	{
-		checkAndMakeOptionList(*a, result, text_scale, data_prop);
+		checkAndMakeOptionList(*a, result, text_scale, bounds);
 	}
-	addAlAuOlOu(data_prop, result, text_scale);
+	addAlAuOlOu(bounds, result, text_scale);
+	streamPrimitives(result, stems);
 
 	return result;
 }
@@ -1004,91 +991,194 @@ then re-add the default ones.
  */
 void Environment::reset() {
 
-	envmap.clear();
+	static const std::shared_ptr<Frame> builtins = makeBuiltins();
+	frame = builtins;
+	constantsRebound = false;
+}
+
+bool Environment::builtinConstantsIntact() const noexcept {
+
+	return !constantsRebound;
+}
+
+const Environment::EnvResult * Environment::find(const std::string & name) const {
+
+	for (const Frame * scope = frame.get(); scope != nullptr; scope = scope->parent.get()) {
+		auto result = scope->symbols.find(name);
+		if (result != scope->symbols.end())
+			return &result->second;
+	}
+	return nullptr;
+}
+
+const Environment::EnvResult * Environment::lookup(const std::string & name) const {
+
+	const EnvResult * found = find(name);
+	if (!reads || (found != nullptr && (found->type != ExpressionType || found->local)))
+		return found;
+
+	for (const std::string & recent : reads->recent)
+		if (recent == name)
+			return found;
+	reads->names->insert(name);
+	reads->recent[reads->next] = name;
+	reads->next = (reads->next + 1) % READ_LOG_RECENT;
+	return found;
+}
+
+void Environment::pushFrame() {
+
+	std::shared_ptr<Frame> top = std::make_shared<Frame>();
+	if (frame->depth < MAX_FRAME_DEPTH) {
+		top->parent = frame;
+		top->depth = frame->depth + 1;
+		frame = top;
+		return;
+	}
+
+	// flatten the chain, outer frames first so inner bindings win
+	std::vector<const Frame *> chain;
+	for (const Frame * scope = frame.get(); scope != nullptr; scope = scope->parent.get())
+		chain.push_back(scope);
+	for (auto scope = chain.rbegin(); scope != chain.rend(); ++scope)
+		for (auto & binding : (*scope)->symbols)
+			top->symbols[binding.first] = binding.second;
+	frame = top;
+}
+
+std::shared_ptr<Environment::Frame> Environment::makeBuiltins() {
+
+	std::shared_ptr<Frame> builtins = std::make_shared<Frame>();
 
 	// Built-In value of pi
-	envmap.emplace("pi", EnvResult(ExpressionType, Expression(PI)));
+	builtins->symbols.emplace("pi", EnvResult(ExpressionType, Expression(PI)));
 
 	// Built-In value of e
-	envmap.emplace("e", EnvResult(ExpressionType, Expression(EXP)));
+	builtins->symbols.emplace("e", EnvResult(ExpressionType, Expression(EXP)));
 
 	// Build-In value of I
-	envmap.emplace("I", EnvResult(ExpressionType, Expression(IMAGINARYNUM)));
+	builtins->symbols.emplace("I", EnvResult(ExpressionType, Expression(IMAGINARYNUM)));
 
 	// Making A list 
-	envmap.emplace("list", EnvResult(ProcedureType, makelist));
+	builtins->symbols.emplace("list", EnvResult(ProcedureType, makelist));
 
 	// getting first element of the list
-	envmap.emplace("first", EnvResult(ProcedureType, firstinlist));
+	builtins->symbols.emplace("first", EnvResult(ProcedureType, firstinlist));
 
 	// getting from second element to the end of the list
-	envmap.emplace("rest", EnvResult(ProcedureType, restoflist));
+	builtins->symbols.emplace("rest", EnvResult(ProcedureType, restoflist));
 
 	// getting number of items inside a list
-	envmap.emplace("length", EnvResult(ProcedureType, listsize));
+	builtins->symbols.emplace("length", EnvResult(ProcedureType, listsize));
 
 	// appends the expression of second arg to first list arg
-	envmap.emplace("append", EnvResult(ProcedureType, appending));
+	builtins->symbols.emplace("append", EnvResult(ProcedureType, appending));
 
 	// join 2 list together
-	envmap.emplace("join", EnvResult(ProcedureType, joinlist));
+	builtins->symbols.emplace("join", EnvResult(ProcedureType, joinlist));
 
 	// join 2 list together
-	envmap.emplace("range", EnvResult(ProcedureType, rangelist));
+	builtins->symbols.emplace("range", EnvResult(ProcedureType, rangelist));
+
+	// pair up the elements of lists
+	builtins->symbols.emplace("zip", EnvResult(ProcedureType, ziplists));
+
+	// load numeric columns from data files
+	builtins->symbols.emplace("read-csv", EnvResult(ProcedureType, readcsv));
+	builtins->symbols.emplace("read-binary", EnvResult(ProcedureType, readbinary));
+
+	// keep expressions between sessions in PLSB files
+	builtins->symbols.emplace("save", EnvResult(ProcedureType, saveproc));
+	builtins->symbols.emplace("load", EnvResult(ProcedureType, loadproc));
 
 	// Procedure: add;
-	envmap.emplace("+", EnvResult(ProcedureType, add));
+	builtins->symbols.emplace("+", EnvResult(ProcedureType, add));
 	
 	// Procedure: subneg;
-	envmap.emplace("-", EnvResult(ProcedureType, subneg));
+	builtins->symbols.emplace("-", EnvResult(ProcedureType, subneg));
 
 	// Procedure: mul;
-	envmap.emplace("*", EnvResult(ProcedureType, mul));
+	builtins->symbols.emplace("*", EnvResult(ProcedureType, mul));
 
 	// Procedure: div;
-	envmap.emplace("/", EnvResult(ProcedureType, div));
+	builtins->symbols.emplace("/", EnvResult(ProcedureType, div));
 
 	//Procedure: sqrt
-	envmap.emplace("sqrt", EnvResult(ProcedureType, squareroot));
+	builtins->symbols.emplace("sqrt", EnvResult(ProcedureType, squareroot));
 
 	//Procedure: ^
-	envmap.emplace("^", EnvResult(ProcedureType, tothepower));
+	builtins->symbols.emplace("^", EnvResult(ProcedureType, tothepower));
 
 	//Procedure: ln
-	envmap.emplace("ln", EnvResult(ProcedureType, naturelog));
+	builtins->symbols.emplace("ln", EnvResult(ProcedureType, naturelog));
 
 	//Procedure: sine
-	envmap.emplace("sin", EnvResult(ProcedureType, sine));
+	builtins->symbols.emplace("sin", EnvResult(ProcedureType, sine));
 
 	//Procedure: cosine
-	envmap.emplace("cos", EnvResult(ProcedureType, cosine));
+	builtins->symbols.emplace("cos", EnvResult(ProcedureType, cosine));
 
 	//Procedure: tangent
-	envmap.emplace("tan", EnvResult(ProcedureType, tangent));
+	builtins->symbols.emplace("tan", EnvResult(ProcedureType, tangent));
 
 	//Procedure: real number
-	envmap.emplace("real", EnvResult(ProcedureType, realnumber));
+	builtins->symbols.emplace("real", EnvResult(ProcedureType, realnumber));
 
 	//Procedure: imaginary number
-	envmap.emplace("imag", EnvResult(ProcedureType, imagnumber));
+	builtins->symbols.emplace("imag", EnvResult(ProcedureType, imagnumber));
 
 	//Procedure: magnitude
-	envmap.emplace("mag", EnvResult(ProcedureType, magnitude));
+	builtins->symbols.emplace("mag", EnvResult(ProcedureType, magnitude));
 
 	//Procedure: argument phase or angle
-	envmap.emplace("arg", EnvResult(ProcedureType, argument));
+	builtins->symbols.emplace("arg", EnvResult(ProcedureType, argument));
 
 	//Procedure: conjugate
-	envmap.emplace("conj", EnvResult(ProcedureType, conjugate));
+	builtins->symbols.emplace("conj", EnvResult(ProcedureType, conjugate));
 
 	//Procedure: argument phase or angle
-	envmap.emplace("arg", EnvResult(ProcedureType, argument));
+	builtins->symbols.emplace("arg", EnvResult(ProcedureType, argument));
 
 	//Procedure: discrete plot
-	envmap.emplace("discrete-plot", EnvResult(ProcedureType, discreteplot));
+	builtins->symbols.emplace("discrete-plot", EnvResult(ProcedureType, discreteplot));
+
+	//Procedure: smallest and largest of numbers
+	builtins->symbols.emplace("min", EnvResult(ProcedureType, minimum));
+	builtins->symbols.emplace("max", EnvResult(ProcedureType, maximum));
+
+	//Procedure: comparisons
+	builtins->symbols.emplace("<", EnvResult(ProcedureType, lessthan));
+	builtins->symbols.emplace(">", EnvResult(ProcedureType, greaterthan));
+
+	return builtins;
 }
 
 void Environment::setInterruptSignal(MessageQueueStr * signal)
 {
 	InterruptSig = signal;
 }
+
+void Environment::recordReads(const std::shared_ptr<std::set<std::string>> & log)
+{
+	reads.reset();
+	if (log) {
+		reads = std::make_shared<ReadLog>();
+		reads->names = log;
+	}
+}
+
+void Environment::beginProcedureScope()
+{
+	procedureScope = true;
+}
+
+void Environment::setCancellation(Cancellation * control)
+{
+	cancellation = control;
+}
+
+void Environment::checkCancellation() const
+{
+	if (cancellation != nullptr)
+		cancellation->check();
+}
@@ -12,12 +12,22 @@ needed.
 
 // system includes
 #include <map>
+#include <memory>
+#include <set>
+#include <string>
 
 // module includes
 #include "atom.hpp"
+#include "cancellation.hpp"
 #include "expression.hpp"
 
 
+/// number of stacked frames after which an environment is flattened into one
+const std::size_t MAX_FRAME_DEPTH = 8;
+
+/// names remembered by a read log to skip inserting them again
+const std::size_t READ_LOG_RECENT = 4;
+
 /*! \typedef Procedure
 \brief A Procedure is a C++ function pointer taking a vector of 
        Expressions as arguments and returning an Expression.
@@ -37,6 +47,10 @@ return you can obtain
 the mapped-to value using get_exp or get_proc.
 
 To add an symbol to expression mapping use the add_exp member function.
+
+Copying an environment is constant time: copies share their frames of
+bindings and a definition made in a shared frame goes into a new frame
+stacked on top of it.
  */
 class Environment {
 public:
@@ -96,11 +110,39 @@ public:
   // get user define procedure which is an expression.
  Expression get_UserDefineProc(const Atom & sym) const;
 
-  /*! Reset the environment to its default state. */
+  /// true if pi, e and I have never been redefined in this environment
+  bool builtinConstantsIntact() const noexcept;
+
+  /*! Reset the environment to its default state.
+
+    The built-in frame is created once and shared by every environment.
+   */
   void reset();
 
   MessageQueueStr * InterruptSig = nullptr;
   void setInterruptSignal(MessageQueueStr * signal);
+
+  /*! Record the symbols looked up from now on that are unknown or bound to
+    an expression outside a procedure call, i.e. the definitions an
+    evaluation depends on.
+    \param reads receives the names, shared by copies of the environment; nullptr stops recording
+   */
+  void recordReads(const std::shared_ptr<std::set<std::string>> & reads);
+
+  /*! Bind the symbols added from now on as locals of a procedure call, such
+    as its parameters, which are not recorded as reads.
+   */
+  void beginProcedureScope();
+
+  /*! Stop the evaluation at its next check once cancellation is cancelled or
+    runs out of time.
+    \param cancellation shared by copies of the environment; nullptr evaluates without limit
+   */
+  void setCancellation(Cancellation * cancellation);
+
+  /// throw a SemanticError if the evaluation was cancelled or ran out of time
+  void checkCancellation() const;
+
 private:
   
   // Environment is a mapping from symbols to expressions or procedures
@@ -110,6 +152,7 @@ private:
     EnvResultType type;
     Expression exp; // used when type is ExpressionType
     Procedure proc; // used when type is ProcedureType
+    bool local = false; // bound by a procedure call
 
     // constructors for use in container emplace
     EnvResult(){};
@@ -117,8 +160,46 @@ private:
     EnvResult(EnvResultType t, Procedure p) : type(t), proc(p){};
   };
 
-  // the environment map
-  std::map<std::string, EnvResult> envmap;
+  typedef std::map<std::string, EnvResult> EnvMap;
+
+  // a scope of bindings, shadowing the bindings of its parent
+  struct Frame {
+    EnvMap symbols;
+    std::shared_ptr<const Frame> parent;
+    std::size_t depth = 0;
+  };
+
+  // set when pi, e or I is redefined, checked by optimized expressions
+  bool constantsRebound = false;
+
+  // names of the definitions looked up; recent holds the names put in
+  // last, which a loop reading them again does not insert
+  struct ReadLog {
+    std::shared_ptr<std::set<std::string>> names;
+    std::string recent[READ_LOG_RECENT];
+    std::size_t next = 0;
+  };
+
+  // null when not recording
+  std::shared_ptr<ReadLog> reads;
+  bool procedureScope = false;
+  Cancellation * cancellation = nullptr;
+
+  // the innermost frame, shared between copies of the environment until one
+  // of them defines a symbol, which then goes into a new frame of its own
+  std::shared_ptr<Frame> frame;
+
+  // find the innermost binding of name, nullptr if it is unknown
+  const EnvResult * find(const std::string & name) const;
+
+  // find name and record it as read
+  const EnvResult * lookup(const std::string & name) const;
+
+  // put a new empty frame on top, flattening the chain when it gets too deep
+  void pushFrame();
+
+  // the built-in procedures and definitions
+  static std::shared_ptr<Frame> makeBuiltins();
 };
 
 #endif
@@ -88,6 +88,72 @@ TEST_CASE( "Test reset", "[environment]" ) {
   REQUIRE(env.get_exp(Atom("hi")) == Expression());
 }
 
+TEST_CASE( "Test copies do not share definitions", "[environment]" ) {
+
+  Environment env;
+  env.add_exp(Atom("one"), Expression(Atom(1.0)));
+
+  Environment copy = env;
+  copy.add_exp(Atom("two"), Expression(Atom(2.0)));
+  copy.add_exp(Atom("one"), Expression(Atom(3.0)));
+
+  REQUIRE(env.get_exp(Atom("one")) == Expression(Atom(1.0)));
+  REQUIRE(!env.is_known(Atom("two")));
+  REQUIRE(copy.get_exp(Atom("one")) == Expression(Atom(3.0)));
+  REQUIRE(copy.is_known(Atom("two")));
+
+  Environment fresh;
+  REQUIRE(!fresh.is_known(Atom("one")));
+}
+
+TEST_CASE( "Test long chains of copies", "[environment]" ) {
+
+  std::vector<Environment> versions(1);
+  for (std::size_t i = 0; i < 3 * MAX_FRAME_DEPTH; i++) {
+    Environment next = versions.back();
+    next.add_exp(Atom("v" + std::to_string(i)), Expression(Atom(double(i))));
+    next.add_exp(Atom("last"), Expression(Atom(double(i))));
+    versions.push_back(next);
+  }
+
+  for (std::size_t i = 0; i <= 3 * MAX_FRAME_DEPTH; i++) {
+    Environment & env = versions[i];
+    for (std::size_t j = 0; j < 3 * MAX_FRAME_DEPTH; j++)
+      REQUIRE(env.is_known(Atom("v" + std::to_string(j))) == (j < i));
+    if (i > 0)
+      REQUIRE(env.get_exp(Atom("last")) == Expression(Atom(double(i - 1))));
+    REQUIRE(env.is_proc(Atom("+")));
+  }
+}
+
+TEST_CASE( "Test recorded reads", "[environment]" ) {
+
+  Environment env;
+  env.add_exp(Atom("a"), Expression(Atom(1.0)));
+  auto reads = std::make_shared<std::set<std::string>>();
+  env.recordReads(reads);
+
+  // the parameters of a procedure call are not definitions it depends on
+  Environment call = env;
+  call.beginProcedureScope();
+  call.add_exp(Atom("x"), Expression(Atom(2.0)));
+  REQUIRE(call.get_exp(Atom("x")) == Expression(Atom(2.0)));
+  REQUIRE(call.get_exp(Atom("a")) == Expression(Atom(1.0)));
+  REQUIRE(!call.is_known(Atom("b")));
+  REQUIRE(call.is_proc(Atom("+")));
+  REQUIRE(*reads == std::set<std::string>({ "a", "b" }));
+
+  // names read again are recorded once
+  for (int i = 0; i < 10; i++)
+    REQUIRE(env.is_exp(Atom("a")));
+  REQUIRE(reads->size() == 2);
+
+  env.recordReads(nullptr);
+  REQUIRE(env.is_exp(Atom("a")));
+  REQUIRE(!env.is_known(Atom("c")));
+  REQUIRE(reads->size() == 2);
+}
+
 TEST_CASE( "Test semeantic errors", "[environment]" ) {
 
   Environment env;
@@ -502,6 +568,37 @@ TEST_CASE("Test get all built-in procedure for number and complex number", "[env
 		REQUIRE(conjugate(args15_2) == conjugate(args15_2));
 }		
 
+TEST_CASE("Test arithmetic with mixed real and complex arguments", "[environment]") {
+
+	Environment env;
+	Procedure addproc = env.get_proc(Atom("+"));
+	Procedure mulproc = env.get_proc(Atom("*"));
+	Procedure subproc = env.get_proc(Atom("-"));
+	Procedure divproc = env.get_proc(Atom("/"));
+
+	typedef std::complex<double> Complex;
+	VectorExpression mixed = { Expression(2.), Expression(Complex(1, 1)), Expression(3.), Expression(Complex(0, 2)) };
+
+	REQUIRE(addproc(mixed) == Expression(Complex(6, 3)));
+	REQUIRE(mulproc(mixed) == Expression(Complex(-12, 12)));
+	REQUIRE(addproc({ Expression(1.), Expression(2.) }).isHeadNumber());
+	REQUIRE(mulproc({ Expression(Complex(0, 1)), Expression(Complex(0, 1)) }) == Expression(Complex(-1, 0)));
+
+	REQUIRE(subproc({ Expression(Complex(1, 2)) }) == Expression(Complex(-1, -2)));
+	REQUIRE(subproc({ Expression(1.), Expression(Complex(1, 2)) }) == Expression(Complex(0, -2)));
+	REQUIRE(subproc({ Expression(Complex(1, 2)), Expression(1.) }) == Expression(Complex(0, 2)));
+	REQUIRE(divproc({ Expression(Complex(0, 2)), Expression(2.) }) == Expression(Complex(0, 1)));
+	REQUIRE(divproc({ Expression(1.), Expression(Complex(0, 1)) }) == Expression(Complex(0, -1)));
+	REQUIRE(divproc({ Expression(Complex(0, 1)) }) == Expression(Complex(0, -1)));
+
+	// the error names complex numbers when any argument is complex, even after the bad one
+	VectorExpression bad = { Expression(1.), Expression(Atom("a")), Expression(Complex(0, 1)) };
+	REQUIRE_THROWS_WITH(addproc(bad), "Error in call to add complex numbers: argument is not a number or complex number");
+	REQUIRE_THROWS_WITH(mulproc(bad), "Error in call to multiply with complex numbers: argument not a number or complex number");
+	REQUIRE_THROWS_WITH(divproc(bad), "Error in call to division with complexx numbers: invalid number of arguments.");
+	REQUIRE_THROWS_WITH(addproc({ Expression(Atom("a")) }), "Error in call to add, argument not a number");
+}
+
 TEST_CASE("Test get all built-in procedure for list", "[environment]") {
 
 	Environment env;
@@ -1,9 +1,15 @@
 #include "expression.hpp"
 
 #include <sstream>
+#include <atomic>
+#include <cassert>
+#include <cstring>
 #include <list>
+#include <mutex>
 #include<algorithm>
 #include "environment.hpp"
+#include "plot_stream.hpp"
+#include "result_writer.hpp"
 #include "semantic_error.hpp"
 
 
@@ -19,7 +25,7 @@ Expression calcLambda(Atom lambda_name, Expression input, Environment env)
 }
 
 //smooth out the vector
-void curveVector(Expression pointA, Expression pointB, Expression pointC, std::vector<Expression> & result, Atom lambda_name, Environment env)
+void curveVector(const Expression & pointA, const Expression & pointB, const Expression & pointC, std::vector<Expression> & result, Atom lambda_name, Environment env)
 {
 
 	double A_x = pointA.first_of_tail()->head().asNumber();
@@ -64,6 +70,83 @@ void curveVector(Expression pointA, Expression pointB, Expression pointC, std::v
 	}
 	return;
 }
+
+// keywords of the numeric graphics slots, indexed by GraphicSlot
+const char * const SLOT_KEYWORDS[GraphicSlotCount] = { "size", "thickness", "text-scale", "text-rotation" };
+
+// values of "object-name", indexed by GraphicKind
+const char * const GRAPHIC_NAMES[] = { "", "point", "line", "text" };
+
+int slotOf(const std::string & keyword)
+{
+	for (int s = 0; s < GraphicSlotCount; s++)
+		if (keyword == SLOT_KEYWORDS[s])
+			return s;
+	return -1;
+}
+
+// an expression that is only an atom, so a slot can hold it without loss
+bool isPlainAtom(const Expression & exp)
+{
+	return exp.isTailEmpty() && exp.propertySize() == 0;
+}
+
+GraphicKind graphicOf(const Expression & name)
+{
+	if (name.isHeadStringConstant())
+		for (int kind = PointGraphic; kind <= TextGraphic; kind++)
+			if (name.head().asStringConstant() == GRAPHIC_NAMES[kind])
+				return static_cast<GraphicKind>(kind);
+	return NoGraphic;
+}
+
+// 64 bit FNV-1a, the same in every run so hashes can key files
+std::uint64_t hashText(const std::string & text)
+{
+	std::uint64_t hash = 14695981039346656037ull;
+	for (unsigned char c : text)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::uint64_t hashNumber(double value)
+{
+	std::uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+std::uint64_t mixHash(std::uint64_t seed, std::uint64_t value)
+{
+	return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+// what Atom::operator== compares exactly: the kind, and the text of symbols and strings
+std::uint64_t atomShape(const Atom & atom)
+{
+	if (atom.isSymbol())
+		return mixHash(1, hashText(atom.asSymbol()));
+	if (atom.isStringConstant())
+		return mixHash(2, hashText(atom.asStringConstant()));
+	return atom.isNumber() ? 3 : atom.isComplexNumber() ? 4 : 5;
+}
+
+std::uint64_t atomHash(const Atom & atom)
+{
+	std::uint64_t hash = atomShape(atom);
+	if (atom.isNumber())
+		hash = mixHash(hash, hashNumber(atom.asNumber()));
+	else if (atom.isComplexNumber())
+		hash = mixHash(mixHash(hash, hashNumber(atom.asRealNumber())), hashNumber(atom.asImaginaryNumber()));
+	return atom.isInsideLambda() ? mixHash(hash, 6) : hash;
+}
+
+// seed of the hash of a tail, also the hash of an empty one
+const std::uint64_t TAIL_SEED = 0x2545f4914f6cdd1dull;
+
 /************************************************************************************************************************************
 END
 **************************************************************************************************************************************/
@@ -76,14 +159,61 @@ Expression::Expression(const Atom & a) {
 	m_head = a;
 }
 
-// recursive copy
-Expression::Expression(const Expression & a) {
+// the tail begin + k * step for k < count, or (*values)[offset + k] for a
+// packed list, filled in when it is first needed
+struct NumericSequence
+{
+	double begin = 0;
+	double step = 0;
+	std::size_t count = 0;
+	std::shared_ptr<const std::vector<double>> values;
+	std::size_t offset = 0;
+	std::once_flag filled;
+
+	double at(std::size_t k) const {
+		return values ? (*values)[offset + k] : begin + k * step;
+	}
+};
+
+// bit of slotsSet telling the position slot is set, numeric slots use bit 1 << slot
+const unsigned POSITION_BIT = 1u << GraphicSlotCount;
+
+// a hash computed on first use, 0 until then; a copy of a body is made to
+// be modified, so it starts over
+struct CachedHash
+{
+	std::atomic<std::uint64_t> value{ 0 };
+
+	CachedHash() = default;
+	CachedHash(const CachedHash &) {}
+	CachedHash & operator=(const CachedHash &) { value = 0; return *this; }
+};
+
+struct Expression::Body
+{
+	std::vector<Expression> tail;
+
+	// properties without a fixed slot
+	std::map<std::string, Expression> property;
+
+	// graphics properties, a slot holds a value when its bit in slotsSet is set
+	GraphicKind graphic = NoGraphic;
+	unsigned slotsSet = 0;
+	double slot[GraphicSlotCount] = {};
+	Expression position;
+
+	std::shared_ptr<const Rewrite> rewrite;
+	std::shared_ptr<NumericSequence> sequence;
+
+	// hashes of the tail and properties, see hash() and shapeHash()
+	CachedHash hash;
+	CachedHash shape;
+};
+
+// shares the body, the head is assigned so every atom kind and flag is kept
+Expression::Expression(const Expression & a) : m_body(a.m_body) {
 
 	m_head = a.m_head;
-	m_property = a.m_property;
-	for (auto e : a.m_tail) {
-		m_tail.push_back(e);
-	}
 }
 
 Expression & Expression::operator=(const Expression & a) {
@@ -92,16 +222,142 @@ Expression & Expression::operator=(const Expression & a) {
 	// compare 2 mem address, not the object inside it.
 	if (this != &a) {
 		m_head = a.m_head;
-		m_property = a.m_property;
-		m_tail.clear();
-		for (auto e : a.m_tail) {
-			m_tail.push_back(e);
-		}
+		m_body = a.m_body;
 	}
 
 	return *this;
 }
 
+const std::vector<Expression> & Expression::tailList() const noexcept {
+
+	static const std::vector<Expression> empty;
+	if (!m_body)
+		return empty;
+
+	// sequences are shared between threads, call_once fills the tail exactly once
+	if (m_body->sequence) {
+		Body & body = *m_body;
+		std::call_once(body.sequence->filled, [&body]() {
+			body.tail.reserve(body.sequence->count);
+			for (std::size_t k = 0; k < body.sequence->count; k++)
+				body.tail.emplace_back(Atom(body.sequence->at(k)));
+		});
+	}
+	return m_body->tail;
+}
+
+Expression::Body & Expression::editBody() {
+
+	if (!m_body)
+		m_body = std::make_shared<Body>();
+	else if (m_body->sequence)
+		tailList();
+
+	if (m_body.use_count() > 1)
+		m_body = std::make_shared<Body>(*m_body);
+
+	// the rewrite, sequence and hashes describe the unmodified expression
+	m_body->rewrite.reset();
+	m_body->sequence.reset();
+	m_body->hash.value = 0;
+	m_body->shape.value = 0;
+	return *m_body;
+}
+
+void Expression::assertNotHashed() const noexcept {
+
+	// a hashed body may sit below hashed expressions that would not see the
+	// change; a body shared with other copies is copied by editBody instead
+	assert(m_body.use_count() != 1 || (m_body->hash.value == 0 && m_body->shape.value == 0));
+}
+
+Expression Expression::makeSequence(double begin, double step, std::size_t count) {
+
+	Expression result(Atom("list"));
+	if (count > 0) {
+		result.m_body = std::make_shared<Body>();
+		result.m_body->sequence = std::make_shared<NumericSequence>();
+		result.m_body->sequence->begin = begin;
+		result.m_body->sequence->step = step;
+		result.m_body->sequence->count = count;
+	}
+	return result;
+}
+
+Expression Expression::makeNumbers(std::shared_ptr<const std::vector<double>> values) {
+
+	Expression result(Atom("list"));
+	if (values && !values->empty()) {
+		result.m_body = std::make_shared<Body>();
+		result.m_body->sequence = std::make_shared<NumericSequence>();
+		result.m_body->sequence->count = values->size();
+		result.m_body->sequence->values = values;
+	}
+	return result;
+}
+
+bool Expression::isNumericSequence() const noexcept {
+
+	return m_body && m_body->sequence;
+}
+
+Expression Expression::tailAt(std::size_t k) const {
+
+	if (m_body && m_body->sequence)
+		return Expression(Atom(m_body->sequence->at(k)));
+
+	return tailList().at(k);
+}
+
+Expression Expression::tailFrom(std::size_t k) const {
+
+	Expression result(m_head);
+	std::size_t size = tailSize();
+	if (k >= size)
+		return result;
+
+	if (m_body->sequence) {
+		const NumericSequence & sequence = *m_body->sequence;
+		if (!sequence.values)
+			return makeSequence(sequence.begin + k * sequence.step, sequence.step, size - k);
+
+		result.m_body = std::make_shared<Body>();
+		result.m_body->sequence = std::make_shared<NumericSequence>();
+		result.m_body->sequence->offset = sequence.offset + k;
+		result.m_body->sequence->count = size - k;
+		result.m_body->sequence->values = sequence.values;
+		return result;
+	}
+
+	auto & body = result.editBody();
+	body.tail.assign(tailList().begin() + k, tailList().end());
+	return result;
+}
+
+void Expression::setRewrite(const std::shared_ptr<const Rewrite> & rewrite) {
+
+	editBody().rewrite = rewrite;
+}
+
+const Rewrite * Expression::rewrite() const noexcept {
+
+	return m_body ? m_body->rewrite.get() : nullptr;
+}
+
+// true if the assumptions of rewrite hold in env
+bool rewriteApplies(const Rewrite & rewrite, const Environment & env) {
+
+	if (rewrite.usesConstants && !env.builtinConstantsIntact())
+		return false;
+
+	if (rewrite.procedure.isSymbol()) {
+		if (!env.is_userDefine(rewrite.procedure) || env.get_UserDefineProc(rewrite.procedure) != rewrite.lambda)
+			return false;
+	}
+
+	return true;
+}
+
 // why one with constant atom ? 
 Atom & Expression::head() {
 	return m_head;
@@ -131,23 +387,38 @@ bool Expression::isHeadComplex() const noexcept
 
 bool Expression::isTailEmpty() const noexcept
 {
-	return m_tail.empty();
+	return tailSize() == 0;
 }
 
 
 void Expression::append(const Atom & a) {
-	m_tail.emplace_back(a);
+	editBody().tail.emplace_back(a);
 }
 
 void Expression::pushback(const Expression & a) {
-	m_tail.push_back(a);
+	editBody().tail.push_back(a);
+}
+
+void Expression::reserveTail(std::size_t n) {
+	editBody().tail.reserve(n);
 }
 
 Expression * Expression::tail() {
 	Expression * ptr = nullptr;
 
-	if (m_tail.size() > 0) {
-		ptr = &m_tail.back();
+	if (tailList().size() > 0) {
+		assertNotHashed();
+		ptr = &editBody().tail.back();
+	}
+
+	return ptr;
+}
+
+const Expression * Expression::tail() const {
+	const Expression * ptr = nullptr;
+
+	if (tailList().size() > 0) {
+		ptr = &tailList().back();
 	}
 
 	return ptr;
@@ -157,8 +428,20 @@ Expression * Expression::first_of_tail()
 {
 	Expression * ptr = nullptr;
 
-	if (m_tail.size() > 0) {
-		ptr = &m_tail.front();
+	if (tailList().size() > 0) {
+		assertNotHashed();
+		ptr = &editBody().tail.front();
+	}
+
+	return ptr;
+}
+
+const Expression * Expression::first_of_tail() const
+{
+	const Expression * ptr = nullptr;
+
+	if (tailList().size() > 0) {
+		ptr = &tailList().front();
 	}
 
 	return ptr;
@@ -167,42 +450,161 @@ Expression * Expression::first_of_tail()
  
 int Expression::propertySize() const noexcept
 {
-	return m_property.size();
+	if (!m_body)
+		return 0;
+
+	int size = m_body->property.size() + (m_body->graphic != NoGraphic ? 1 : 0);
+	for (unsigned bits = m_body->slotsSet; bits != 0; bits &= bits - 1)
+		size++;
+	return size;
 }
 
 void Expression::add_property(const std::string & keyword, const Expression & exp)
 {
-	m_property[keyword] = exp;
+	if (keyword == "position") {
+		setGraphicPosition(exp);
+		return;
+	}
+
+	Body & body = editBody();
+	int slot = slotOf(keyword);
+
+	if (keyword == "object-name") {
+		body.graphic = isPlainAtom(exp) ? graphicOf(exp) : NoGraphic;
+		if (body.graphic != NoGraphic) {
+			body.property.erase(keyword);
+			return;
+		}
+	}
+	else if (slot >= 0) {
+		body.slotsSet &= ~(1u << slot);
+		if (isPlainAtom(exp) && exp.isHeadNumber()) {
+			setGraphicSlot(static_cast<GraphicSlot>(slot), exp.head().asNumber());
+			return;
+		}
+	}
+
+	body.property[keyword] = exp;
 }
 
 int Expression::tailSize() const noexcept
 {
-	return m_tail.size();
+	if (m_body && m_body->sequence)
+		return m_body->sequence->count;
+
+	return tailList().size();
 }
 
 Expression Expression::getProperty(const std::string & keyword) const noexcept
 {
 	Expression result;
+	if (!m_body)
+		return result;
 
-	auto it = m_property.find(keyword);
-	if (it != m_property.cend())
-		result = it->second;
+	int slot = slotOf(keyword);
+
+	if (keyword == "object-name" && m_body->graphic != NoGraphic) {
+		Atom name(GRAPHIC_NAMES[m_body->graphic]);
+		name.setStringType();
+		result = Expression(name);
+	}
+	else if (keyword == "position" && (m_body->slotsSet & POSITION_BIT))
+		result = m_body->position;
+	else if (slot >= 0 && (m_body->slotsSet & (1u << slot)))
+		result = Expression(Atom(m_body->slot[slot]));
+	else {
+		auto it = m_body->property.find(keyword);
+		if (it != m_body->property.cend())
+			result = it->second;
+	}
 
 	return result;
 }
 
+std::vector<std::string> Expression::propertyKeywords() const
+{
+	std::vector<std::string> keywords;
+	if (!m_body)
+		return keywords;
+
+	if (m_body->graphic != NoGraphic)
+		keywords.push_back("object-name");
+	if (m_body->slotsSet & POSITION_BIT)
+		keywords.push_back("position");
+	for (int slot = 0; slot < GraphicSlotCount; slot++)
+		if (m_body->slotsSet & (1u << slot))
+			keywords.push_back(SLOT_KEYWORDS[slot]);
+	for (auto & entry : m_body->property)
+		keywords.push_back(entry.first);
+
+	return keywords;
+}
+
+GraphicKind Expression::graphicKind() const noexcept
+{
+	if (!m_body)
+		return NoGraphic;
+
+	if (m_body->graphic != NoGraphic)
+		return m_body->graphic;
+
+	// a name with properties or a tail of its own is kept in the map
+	auto it = m_body->property.find("object-name");
+	return (it == m_body->property.cend()) ? NoGraphic : graphicOf(Expression(it->second.head()));
+}
+
+double Expression::graphicSlot(GraphicSlot slot) const noexcept
+{
+	if (!m_body)
+		return 0;
+
+	if (m_body->slotsSet & (1u << slot))
+		return m_body->slot[slot];
+
+	auto it = m_body->property.find(SLOT_KEYWORDS[slot]);
+	return (it == m_body->property.cend()) ? 0 : it->second.head().asNumber();
+}
+
+const Expression * Expression::graphicPosition() const noexcept
+{
+	return (m_body && (m_body->slotsSet & POSITION_BIT)) ? &m_body->position : nullptr;
+}
+
+void Expression::setGraphicKind(GraphicKind kind)
+{
+	Body & body = editBody();
+	body.graphic = kind;
+	body.property.erase("object-name");
+}
+
+void Expression::setGraphicSlot(GraphicSlot slot, double value)
+{
+	Body & body = editBody();
+	body.slot[slot] = value;
+	body.slotsSet |= 1u << slot;
+	body.property.erase(SLOT_KEYWORDS[slot]);
+}
+
+void Expression::setGraphicPosition(const Expression & position)
+{
+	Body & body = editBody();
+	body.position = position;
+	body.slotsSet |= POSITION_BIT;
+}
+
 Expression::ConstIteratorType Expression::tailConstBegin() const noexcept {
-	return m_tail.cbegin();
+	return tailList().cbegin();
 }
 
 Expression::ConstIteratorType Expression::tailConstEnd() const noexcept {
-	return m_tail.cend();
+	return tailList().cend();
 }
 
 // userDefineProc is a lambda tree and args is input argument from user
-Expression handle_userDefine(Expression userDefineProc, const std::vector<Expression> & args, const Environment & env)
+Expression handle_userDefine(const Expression & userDefineProc, const std::vector<Expression> & args, const Environment & env)
 {
 	Environment tempEnvironment = env;
+	tempEnvironment.beginProcedureScope();
 	int argumentSize = args.size();
 	if (!(userDefineProc.tailConstBegin()->tailSize() == argumentSize))
 		throw SemanticError("Error during evaluation: unknown symbol");
@@ -254,7 +656,7 @@ Expression apply(const Atom & op, const std::vector<Expression> & args, const En
 }
 
 
-Expression Expression::handle_lookup(const Atom & head, const Environment & env) {
+Expression Expression::handle_lookup(const Atom & head, const Environment & env) const {
 	if (head.isSymbol()) { // if symbol is in env return value
 		if (env.is_exp(head)) {
 			return env.get_exp(head);
@@ -275,15 +677,15 @@ Expression Expression::handle_lookup(const Atom & head, const Environment & env)
 }
 
 
-Expression Expression::handle_begin(Environment & env) {
+Expression Expression::handle_begin(Environment & env) const {
 
-	if (m_tail.size() == 0) {
+	if (tailList().size() == 0) {
 		throw SemanticError("Error during evaluation: zero arguments to begin");
 	}
 
 	// evaluate each arg from tail, return the last
 	Expression result;
-	for (Expression::IteratorType it = m_tail.begin(); it != m_tail.end(); ++it) {
+	for (auto it = tailList().begin(); it != tailList().end(); ++it) {
 		result = it->eval(env);
 	}
 
@@ -291,70 +693,72 @@ Expression Expression::handle_begin(Environment & env) {
 }
 
 
-Expression Expression::handle_lambda(Environment & env)
+Expression Expression::handle_lambda(Environment & env) const
 {
 	// tail must have size 2 or error
-	if (m_tail.size() != 2)
+	if (tailList().size() != 2)
 		throw SemanticError("Error during evaluation: invalid number of arguments to lambda");
 
 	// tail[0] must be symbol
-	if (!m_tail[0].isHeadSymbol())
+	if (!tailList()[0].isHeadSymbol())
 		throw SemanticError("Error during evaluation: first argument in lambda not symbol");
 
 	// make an list of all argument and also check if the argument of the function is valid
-	std::string s = m_tail[0].head().asSymbol();
+	std::string s = tailList()[0].head().asSymbol();
 	if ((s == "define") || (s == "begin"))
 		throw SemanticError("Error during evaluation: attempt to redefine a special-form");
 
-	if (env.is_proc(m_tail[0].head().asSymbol()))
+	if (env.is_proc(tailList()[0].head().asSymbol()))
 		throw SemanticError("Error during evaluation: attempt to redefine a built-in procedure");
 
-	Expression argumentList = env.make_list(m_tail[0]);
+	Expression argumentList = env.make_list(tailList()[0]);
 	Expression result(Atom("lambda"));
 	result.pushback(argumentList);
-	m_tail[1].head().setInsideLambda();
-	result.pushback(m_tail[1]);
+	// flag a copy, the body may be shared with other expressions
+	Expression body = tailList()[1];
+	body.head().setInsideLambda();
+	result.pushback(body);
 
 	return result;
 }
 
 
-Expression Expression::handle_apply(Environment & env)
+Expression Expression::handle_apply(Environment & env) const
 {
 
 	if (!(this->tailSize() == 2))
 		throw SemanticError("Error during evaluation: invalid argument of apply");
 
-	if (!m_tail[0].isTailEmpty())
+	if (!tailList()[0].isTailEmpty())
 		throw SemanticError("Error during apply: first argument to apply not a precedure");
 
-	if (m_tail[1].head().asSymbol() != "list")
+	if (tailList()[1].head().asSymbol() != "list")
 		throw SemanticError("Error during apply: second argument to apply not a list");
 
 	std::vector<Expression> answer;
-	Expression results = (m_tail[1].eval(env));
+	Expression results = (tailList()[1].eval(env));
 
 	for (auto a = results.tailConstBegin(); a != results.tailConstEnd(); a++)
 		answer.push_back(*a);
 
-	return apply(m_tail.begin()->head().asSymbol(), answer, env);
+	return apply(tailList().begin()->head().asSymbol(), answer, env);
 }
 
 
-Expression Expression::handle_define(Environment & env) {
+Expression Expression::handle_define(Environment & env) const {
 
 	// tail must have size 3 or error
-	if (m_tail.size() != 2) {
+	if (tailList().size() != 2) {
 		throw SemanticError("Error during evaluation: invalid number of arguments to define");
 	}
 
 	// tail[0] must be symbol
-	if (!m_tail[0].isHeadSymbol()) {
+	if (!tailList()[0].isHeadSymbol()) {
 		throw SemanticError("Error during evaluation: first argument to define not symbol");
 	}
 
 	// but tail[0] must not be a special-form or procedure
-	std::string s = m_tail[0].head().asSymbol();
+	std::string s = tailList()[0].head().asSymbol();
 	if ((s == "define") || (s == "begin")) {
 		throw SemanticError("Error during evaluation: attempt to redefine a special-form");
 	}
@@ -363,27 +767,88 @@ Expression Expression::handle_define(Environment & env) {
 		throw SemanticError("Error during evaluation: attempt to redefine a built-in procedure");
 	}
 	// eval tail[1]
-	Expression result = m_tail[1].eval(env);
+	Expression result = tailList()[1].eval(env);
 
 	if (env.is_exp(m_head)) {
 		throw SemanticError("Error during evaluation: attempt to redefine a previously defined symbol");
 	}
 	
 	//and add to env
-	env.add_exp(m_tail[0].head(), result);
+	env.add_exp(tailList()[0].head(), result);
 
 	return result;
 }
 
 
-Expression Expression::handle_map(Environment & env)
+bool Expression::isFusableStage(const Expression & exp)
+{
+	if (!exp.m_head.isSymbol() || (exp.m_head.asSymbol() != "map" && exp.m_head.asSymbol() != "filter"))
+		return false;
+
+	return exp.tailSize() == 2 && exp.tailList()[0].isTailEmpty() && !exp.m_body->rewrite;
+}
+
+Expression Expression::evalPipelineSource(const Expression & source, Environment & env, std::vector<Stage> & stages)
 {
-	Expression results = (m_tail[1].eval(env));
+	const Expression * node = &source;
+	while (isFusableStage(*node))
+	{
+		stages.push_back(Stage{ node->m_head.asSymbol() == "filter", node->tailList()[0].head() });
+		node = &node->tailList()[1];
+	}
+
+	Expression results = node->eval(env);
+
+	// the innermost stage reports a bad list as it would unfused
+	if (!stages.empty() && results.head().asSymbol() != "list")
+	{
+		if (stages.back().filter)
+			throw SemanticError("Error during filter: second argument to filter not a list");
+		throw SemanticError("Error during map: second argument to map not a list");
+	}
 
+	return results;
+}
+
+// a predicate keeps an element by returning a non-zero number
+bool keeps(const Atom & predicate, const Expression & value, Environment & env)
+{
+	std::vector<Expression> argument(1, value);
+	Expression result = apply(predicate, argument, env);
+
+	if (!result.isHeadNumber())
+		throw SemanticError("Error during filter: predicate did not return a number");
+
+	return result.head().asNumber() != 0;
+}
+
+bool Expression::runStages(const std::vector<Stage> & stages, Expression & value, Environment & env)
+{
+	for (auto stage = stages.rbegin(); stage != stages.rend(); ++stage)
+	{
+		if (stage->filter)
+		{
+			if (!keeps(stage->procedure, value, env))
+				return false;
+		}
+		else
+		{
+			std::vector<Expression> argument(1, value);
+			value = apply(stage->procedure, argument, env);
+		}
+	}
+	return true;
+}
+
+Expression Expression::handle_map(Environment & env) const
+{
 	if (!(this->tailSize() == 2))
 		throw SemanticError("Error during evaluation: invalid argument of map");
 
-	if (!m_tail[0].isTailEmpty())
+	std::vector<Stage> stages;
+	Expression results = evalPipelineSource(tailList()[1], env, stages);
+
+	if (!tailList()[0].isTailEmpty())
 		throw SemanticError("Error during map: first argument to map is not a precedure");
 
 	if (results.head().asSymbol() != "list")
@@ -391,56 +856,142 @@ Expression Expression::handle_map(Environment & env)
 
 	Expression answerList(Atom("list"));
 
-	for (auto a = results.tailConstBegin(); a != results.tailConstEnd(); a++)
+	// by index, so a range is never materialized
+	int size = results.tailSize();
+	for (int k = 0; k < size; k++)
 	{
+		// builtin procedures are applied without eval, which checks otherwise
+		env.checkCancellation();
+		Expression value = results.tailAt(k);
+		if (!runStages(stages, value, env))
+			continue;
+
 		std::vector<Expression> answer;
-		answer.push_back(*a);
-		answerList.pushback(apply(m_tail.begin()->head().asSymbol(), answer, env));
+		answer.push_back(value);
+		answerList.pushback(apply(tailList().begin()->head().asSymbol(), answer, env));
 	}
 
 	return answerList;
 }
 
+Expression Expression::handle_filter(Environment & env) const
+{
+	if (!(this->tailSize() == 2))
+		throw SemanticError("Error during evaluation: invalid argument of filter");
+
+	if (!tailList()[0].isTailEmpty())
+		throw SemanticError("Error during filter: first argument to filter is not a procedure");
+
+	std::vector<Stage> stages;
+	Expression results = evalPipelineSource(tailList()[1], env, stages);
+
+	if (results.head().asSymbol() != "list")
+		throw SemanticError("Error during filter: second argument to filter not a list");
+
+	Expression answerList(Atom("list"));
+
+	int size = results.tailSize();
+	for (int k = 0; k < size; k++)
+	{
+		env.checkCancellation();
+		Expression value = results.tailAt(k);
+		if (runStages(stages, value, env) && keeps(tailList()[0].head(), value, env))
+			answerList.pushback(value);
+	}
 
-Expression Expression::handle_setprop(Environment & env)
+	return answerList;
+}
+
+Expression Expression::handle_reduce(Environment & env) const
+{
+	if (!(this->tailSize() == 2 || this->tailSize() == 3))
+		throw SemanticError("Error during evaluation: invalid argument of reduce");
+
+	if (!tailList()[0].isTailEmpty())
+		throw SemanticError("Error during reduce: first argument to reduce is not a procedure");
+
+	// (reduce f init list) starts from init, (reduce f list) from the first element
+	Expression accumulator;
+	bool started = false;
+	if (this->tailSize() == 3)
+	{
+		accumulator = tailList()[1].eval(env);
+		started = true;
+	}
+
+	std::vector<Stage> stages;
+	Expression results = evalPipelineSource(tailList().back(), env, stages);
+
+	if (results.head().asSymbol() != "list")
+		throw SemanticError("Error during reduce: last argument to reduce not a list");
+
+	int size = results.tailSize();
+	for (int k = 0; k < size; k++)
+	{
+		env.checkCancellation();
+		Expression value = results.tailAt(k);
+		if (!runStages(stages, value, env))
+			continue;
+
+		if (!started)
+		{
+			accumulator = value;
+			started = true;
+			continue;
+		}
+
+		std::vector<Expression> arguments;
+		arguments.push_back(accumulator);
+		arguments.push_back(value);
+		accumulator = apply(tailList()[0].head(), arguments, env);
+	}
+
+	if (!started)
+		throw SemanticError("Error during reduce: empty list and no initial value");
+
+	return accumulator;
+}
+
+
+Expression Expression::handle_setprop(Environment & env) const
 {
 	if (!(this->tailSize() == 3))
 		throw SemanticError("Error in call to handle set property: invalid number of arguments.");
 
-	if (!m_tail[0].isHeadStringConstant())
+	if (!tailList()[0].isHeadStringConstant())
 		throw SemanticError("Error : first argument to set-property is not a string.");
 
 	Expression result;
 
-	result = m_tail[2].eval(env);
-	result.add_property(m_tail[0].head().asStringConstant(), m_tail[1].eval(env));
+	result = tailList()[2].eval(env);
+	result.add_property(tailList()[0].head().asStringConstant(), tailList()[1].eval(env));
 
 	return result;
 }
 
-Expression Expression::handle_getprop(Environment & env)
+Expression Expression::handle_getprop(Environment & env) const
 {
 	if (!(this->tailSize() == 2))
 		throw SemanticError("Error in handle get property: invalid number of arguments.");
 
-	if (!m_tail[0].isHeadStringConstant())
+	if (!tailList()[0].isHeadStringConstant())
 		throw SemanticError("Error in handle get property: first argument is not a string.");
 
-	Expression temp = m_tail[1].eval(env);
+	Expression temp = tailList()[1].eval(env);
 
-	return temp.getProperty(m_tail[0].head().asStringConstant());
+	return temp.getProperty(tailList()[0].head().asStringConstant());
 }
 
-Expression Expression::handle_continuousplot(Environment & env)
+Expression Expression::handle_continuousplot(Environment & env) const
 {
-	Expression user_lambda = m_tail[0];
-	Expression bounder_list = m_tail[1].eval(env);
+	Expression user_lambda = tailList()[0];
+	const Expression bounder_list = tailList()[1].eval(env);
 	Expression option_list;
 
 	double text_scale = 1;
 	if (this->tailSize() > 2)
 	{
-		option_list = m_tail[2].eval(env);
+		option_list = tailList()[2].eval(env);
 		text_scale = getTextScale(option_list);
 	}
 
@@ -486,22 +1037,18 @@ Expression Expression::handle_continuousplot(Environment & env)
 	}
 
 
-	Expression temp_point_list(Atom("list"));
-	for (unsigned int each = 0; each < smoothData.size(); each++)
-	{
-		temp_point_list.pushback(smoothData[each]);
-	}
-
-	std::unordered_map<std::string, double> data_prop = checkAndScalePoints(temp_point_list);
+	PlotBounds bounds = checkAndScalePoints(smoothData.cbegin(), smoothData.cend());
 
 	std::vector<Expression> scaled_point_list;
-	for (auto a = smoothData.begin(); a != smoothData.end(); a++)
+	scaled_point_list.reserve(smoothData.size());
+	for (auto a = smoothData.cbegin(); a != smoothData.cend(); a++)
 	{
-		double xCoordinate = a->first_of_tail()->head().asNumber() * data_prop.at("xScale");
-		double yCoordinate = -1 * a->tail()->head().asNumber() * data_prop.at("yScale");
+		double xCoordinate = a->first_of_tail()->head().asNumber() * bounds.xScale;
+		double yCoordinate = -1 * a->tail()->head().asNumber() * bounds.yScale;
 		scaled_point_list.push_back(makePoint(xCoordinate, yCoordinate, 0));
 	}
 
+	result.reserveTail(scaled_point_list.size() + 16);
 	for (unsigned int i = 0; i < scaled_point_list.size() - 1; i++)
 	{
 		result.pushback(makeLine(scaled_point_list[i], scaled_point_list[i + 1]));
@@ -509,24 +1056,32 @@ Expression Expression::handle_continuousplot(Environment & env)
 
 	for (auto a = option_list.tailConstBegin(); a != option_list.tailConstEnd(); a++)
 	{
-		checkAndMakeOptionList(*a, result, text_scale, data_prop);
+		checkAndMakeOptionList(*a, result, text_scale, bounds);
 	}
 
-	get_borderLine(data_prop, result);
-	addAlAuOlOu(data_prop, result, text_scale);
+	get_borderLine(bounds, result);
+	addAlAuOlOu(bounds, result, text_scale);
+	streamPrimitives(result, 0);
 	return result;
 }
 
 // this is a simple recursive version. the iterative version is more
 // difficult with the ast data structure used (no parent pointer).
 // this limits the practical depth of our AST
-Expression Expression::eval(Environment & env) {
+Expression Expression::eval(Environment & env) const {
 
 	if (env.InterruptSig != nullptr)
 	{
 		throw SemanticError("Error: interpreter kernel interrupted");
 		env.InterruptSig = nullptr;
 	}
+	env.checkCancellation();
+
+	if (m_body && m_body->rewrite && rewriteApplies(*m_body->rewrite, env)) {
+		if (m_body->rewrite->isValue)
+			return m_body->rewrite->replacement;
+		return m_body->rewrite->replacement.eval(env);
+	}
 
 	if (m_head.asSymbol() == "continuous-plot")
 		return handle_continuousplot(env);
@@ -534,6 +1089,12 @@ Expression Expression::eval(Environment & env) {
 	if (m_head.asSymbol() == "map")
 		return handle_map(env);
 
+	else if (m_head.asSymbol() == "filter")
+		return handle_filter(env);
+
+	else if (m_head.asSymbol() == "reduce")
+		return handle_reduce(env);
+
 	else if (m_head.asSymbol() == "apply")
 		return handle_apply(env);
 
@@ -543,7 +1104,7 @@ Expression Expression::eval(Environment & env) {
 	else if (m_head.asSymbol() == "get-property")
 		return handle_getprop(env);
 
-	else if (m_tail.empty() && m_head.asSymbol() != "list") {
+	else if (tailList().empty() && m_head.asSymbol() != "list") {
 		return handle_lookup(m_head, env);
 	}
 	// handle begin special-form
@@ -561,7 +1122,7 @@ Expression Expression::eval(Environment & env) {
 	// else attempt to treat as procedure
 	else {
 		std::vector<Expression> results;
-		for (Expression::IteratorType it = m_tail.begin(); it != m_tail.end(); ++it) {
+		for (auto it = tailList().begin(); it != tailList().end(); ++it) {
 			results.push_back(it->eval(env));
 		}
 		return apply(m_head, results, env);
@@ -570,54 +1131,110 @@ Expression Expression::eval(Environment & env) {
 
 
 std::ostream & operator<<(std::ostream & out, const Expression & exp) {
-	if (exp.head().isNone())
-	{
-		out << "NONE";
-	}
-	else
-	{
-		out << "(";
 
-		if (exp.isHeadSymbol() && (exp.head().asSymbol() == "list"))
-		{
-			if (exp.head().isInsideLambda())
-				out << "list ";
+	ResultWriter writer(static_cast<int>(out.precision()));
+	writer.write(exp, out);
+	return out;
+}
 
-			for (auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e)
-				if (e == exp.tailConstBegin()) out << *e;
-				else out << " " << *e;
-		}
+std::uint64_t Expression::hash() const noexcept {
 
-		else if (exp.isHeadSymbol() && (exp.head().asSymbol() == "lambda"))
-		{
-			for (auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e)
-				if (e == exp.tailConstBegin()) out << *e;
-				else out << " " << *e;
-		}
+	return mixHash(atomHash(m_head), m_body ? bodyHash() : TAIL_SEED);
+}
 
-		else
-		{
-			out << exp.head();
-			for (auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e) {
-				out << " " << *e;
-			}
-		}
+std::uint64_t Expression::shapeHash() const noexcept {
+
+	return mixHash(atomShape(m_head), m_body ? bodyShape() : TAIL_SEED);
+}
+
+std::uint64_t Expression::bodyHash() const noexcept {
+
+	std::uint64_t cached = m_body->hash.value.load(std::memory_order_relaxed);
+	if (cached != 0)
+		return cached;
 
-		out << ")";
+	const Body & body = *m_body;
+	std::uint64_t hash = TAIL_SEED;
+	if (body.sequence) {
+		// hashed like the expressions it stands for, without creating them
+		for (std::size_t k = 0; k < body.sequence->count; k++)
+			hash = mixHash(hash, Expression(Atom(body.sequence->at(k))).hash());
 	}
-	return out;
+	else {
+		for (const Expression & child : body.tail)
+			hash = mixHash(hash, child.hash());
+	}
+
+	if (body.graphic != NoGraphic || body.slotsSet != 0) {
+		hash = mixHash(mixHash(hash, body.graphic), body.slotsSet);
+		for (int s = 0; s < GraphicSlotCount; s++)
+			if (body.slotsSet & (1u << s))
+				hash = mixHash(hash, hashNumber(body.slot[s]));
+		if (body.slotsSet & POSITION_BIT)
+			hash = mixHash(hash, body.position.hash());
+	}
+	for (auto & property : body.property)
+		hash = mixHash(mixHash(hash, hashText(property.first)), property.second.hash());
+
+	// 0 marks a hash not computed yet
+	hash = hash == 0 ? 1 : hash;
+	m_body->hash.value.store(hash, std::memory_order_relaxed);
+	return hash;
 }
 
+std::uint64_t Expression::bodyShape() const noexcept {
+
+	std::uint64_t cached = m_body->shape.value.load(std::memory_order_relaxed);
+	if (cached != 0)
+		return cached;
+
+	const Body & body = *m_body;
+	std::uint64_t shape = TAIL_SEED;
+	if (body.sequence) {
+		std::uint64_t number = Expression(Atom(0.0)).shapeHash();
+		for (std::size_t k = 0; k < body.sequence->count; k++)
+			shape = mixHash(shape, number);
+	}
+	else {
+		for (const Expression & child : body.tail)
+			shape = mixHash(shape, child.shapeHash());
+	}
+
+	shape = shape == 0 ? 1 : shape;
+	m_body->shape.value.store(shape, std::memory_order_relaxed);
+	return shape;
+}
 
 bool Expression::operator==(const Expression & exp) const noexcept {
 
 	bool result = (m_head == exp.m_head);
 
-	result = result && (m_tail.size() == exp.m_tail.size());
+	// expressions sharing a body have equal tails
+	if (!result || m_body == exp.m_body)
+		return result;
+
+	// different shapes cannot compare equal, once the shapes are cached this
+	// rejects most unequal trees without walking them
+	if (shapeHash() != exp.shapeHash())
+		return false;
+
+	// the shapes match, so both tails have the same size; a sequence is
+	// compared element by element instead of being filled in
+	std::size_t size = tailSize();
+	if ((m_body && m_body->sequence) || (exp.m_body && exp.m_body->sequence)) {
+		for (std::size_t k = 0; result && k < size; k++)
+			result = (tailAt(k) == exp.tailAt(k));
+		return result;
+	}
+
+	const std::vector<Expression> & left = tailList();
+	const std::vector<Expression> & right = exp.tailList();
+
+	result = result && (left.size() == right.size());
 
 	if (result) {
-		for (auto lefte = m_tail.begin(), righte = exp.m_tail.begin();
-			(lefte != m_tail.end()) && (righte != exp.m_tail.end());
+		for (auto lefte = left.begin(), righte = right.begin();
+			(lefte != left.end()) && (righte != right.end());
 			++lefte, ++righte) {
 			result = result && (*lefte == *righte);
 		}
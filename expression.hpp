@@ -4,10 +4,11 @@ Defines the Expression type and assiciated functions.
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
-#include <unordered_map>
+#include <memory>
 #include<algorithm>
 #include <iomanip>
 
@@ -23,14 +24,56 @@ const int OUTTERLINE = 3;
 const int SAMPLING = 50;
 typedef message_queue<std::string> MessageQueueStr;
 
+/*! \struct PlotBounds
+\brief Extent of the data of a plot and the scale fitting it into the plot box.
+ */
+struct PlotBounds
+{
+  double xMin, xMax, yMin, yMax;
+  double xScale, yScale;
+
+  /// edges of the plot box in scene coordinates, y grows downwards
+  double left() const { return xScale * xMin; }
+  double right() const { return xScale * xMax; }
+  double top() const { return -1 * yScale * yMax; }
+  double bottom() const { return -1 * yScale * yMin; }
+};
+
+/// kinds of graphics objects, named by the "object-name" property
+enum GraphicKind { NoGraphic, PointGraphic, LineGraphic, TextGraphic };
+
+/// numeric properties of graphics objects: "size", "thickness", "text-scale" and "text-rotation"
+enum GraphicSlot { SizeSlot, ThicknessSlot, TextScaleSlot, TextRotationSlot, GraphicSlotCount };
+
 // forward declare Environment
 class Environment;
 
+// forward declare Rewrite
+struct Rewrite;
+
 /*! \class Expression
 \brief An expression is a tree of Atoms.
 
 An expression is an atom called the head followed by a (possibly empty) 
 list of expressions called the tail.
+
+The tail and the properties are held in a reference counted body, so copies
+of an expression share their subtrees and copying is constant time. A
+body is copied (one level deep) only when an expression sharing it is
+modified. The tail of a list made by makeSequence or makeNumbers is
+computed on demand.
+
+The properties of points, lines and texts are kept in fixed slots of the
+body rather than in its property map; add_property and getProperty hide
+the difference.
+
+Every body caches a hash of its contents (see hash and shapeHash), so
+comparing trees of different shape does not walk them. Modifying an
+expression through the pointers returned by tail and first_of_tail does
+not reach the hashes of the expressions above it, so the non-const tail
+and first_of_tail are for building a tree: once a body has been hashed
+or compared, read it through the const overloads (debug builds assert
+this). A copy may still be modified, it gets a body of its own.
  */
 class Expression {
 public:
@@ -45,10 +88,10 @@ public:
   */
   Expression(const Atom & a);
 
-  /// deep-copy construct an expression (recursive)
+  /// copy construct an expression, sharing the subtrees of a
   Expression(const Expression & a);
 
-  /// deep-copy assign an expression  (recursive)
+  /// copy assign an expression, sharing the subtrees of a
   Expression & operator=(const Expression & a);
 
   /// return a reference to the head Atom
@@ -57,18 +100,51 @@ public:
   /// return a const-reference to the head Atom
   const Atom & head() const;
 
+  /*! Make the list of count numbers begin + k * step without storing them.
+    The numbers are only created when the tail is iterated; tailSize, tailAt
+    and tailFrom work on the sequence directly.
+   */
+  static Expression makeSequence(double begin, double step, std::size_t count);
+
+  /*! Make a list of the numbers in values, sharing them instead of creating
+    an expression for each; like a sequence it is materialized only when the
+    tail is iterated.
+   */
+  static Expression makeNumbers(std::shared_ptr<const std::vector<double>> values);
+
+  /*! true for a list made by makeSequence or makeNumbers and not modified
+    since; its elements are plain numbers that tailAt reads without creating
+    the tail
+   */
+  bool isNumericSequence() const noexcept;
+
+  /// return a copy of element k of the tail (k must be less than tailSize)
+  Expression tailAt(std::size_t k) const;
+
+  /// return an expression with the same head and the tail from element k on, without properties
+  Expression tailFrom(std::size_t k) const;
+
   /// append Atom to tail of the expression
   void append(const Atom & a);
 
   /// push back an expression to tail of expression vector
   void pushback(const Expression & a);
 
-  /// return a pointer to the last expression in the tail, or nullptr
+  /// make room for n tail expressions so building a large list does not reallocate
+  void reserveTail(std::size_t n);
+
+  /// return a pointer to the last expression in the tail, or nullptr; not after hashing
   Expression * tail();
 
-  /// return a point to the first expression in the tail
+  /// return a const pointer to the last expression in the tail, or nullptr
+  const Expression * tail() const;
+
+  /// return a point to the first expression in the tail; not after hashing
   Expression * first_of_tail();
 
+  /// return a const pointer to the first expression in the tail, or nullptr
+  const Expression * first_of_tail() const;
+
   /// set property into the expression
   void add_property(const std::string & keyword,const Expression & exp);
 
@@ -80,6 +156,23 @@ public:
   //get expression property inside property map
   Expression getProperty(const std::string & keyword) const noexcept;
 
+  /// keywords of all properties set on the expression
+  std::vector<std::string> propertyKeywords() const;
+
+  /// kind of graphics object named by the "object-name" property
+  GraphicKind graphicKind() const noexcept;
+
+  /// number stored in a numeric graphics property, 0 if it is not set
+  double graphicSlot(GraphicSlot slot) const noexcept;
+
+  /// the "position" property, or nullptr (no copy)
+  const Expression * graphicPosition() const noexcept;
+
+  /// set the graphics properties directly, same as add_property with their keywords
+  void setGraphicKind(GraphicKind kind);
+  void setGraphicSlot(GraphicSlot slot, double value);
+  void setGraphicPosition(const Expression & position);
+
   // replace the variable inside lambda with the input variable
   //Expression replace_LambdaVariables(const Expression & argument, const Expression & procedure);
 
@@ -105,9 +198,34 @@ public:
   bool isTailEmpty() const noexcept;
 
   /// Evaluate expression using a post-order traversal (recursive)
-  Expression eval(Environment & env);
-
-  /// equality comparison for two expressions (recursive)
+  Expression eval(Environment & env) const;
+
+  /*! Attach an optimized form of this expression, see optimizer.hpp.
+    eval uses the rewrite while its assumptions hold and evaluates the
+    expression itself otherwise. Modifying the expression drops it.
+    \param rewrite the optimized form
+   */
+  void setRewrite(const std::shared_ptr<const Rewrite> & rewrite);
+
+  /// return the attached rewrite, or nullptr
+  const Rewrite * rewrite() const noexcept;
+
+  /*! Hash of the head, tail and properties, equal for expressions that
+    match down to the bits of their numbers and the same in every run, so it
+    can key caches and find duplicates. It is computed once per body and kept
+    until the expression is modified; a list made by makeSequence hashes like
+    the same list built element by element.
+   */
+  std::uint64_t hash() const noexcept;
+
+  /*! Hash of what operator== compares: the kinds of the atoms, the text of
+    symbols and strings and the size of every tail, but not the values of
+    numbers, which compare with a tolerance, nor properties. Equal
+    expressions have equal shape hashes. Cached like hash.
+   */
+  std::uint64_t shapeHash() const noexcept;
+
+  /// equality comparison for two expressions (recursive), properties are not compared
   bool operator==(const Expression & exp) const noexcept;
 
 private:
@@ -116,29 +234,74 @@ private:
   Atom m_head;
 
   // the tail list is expressed as a vector for access efficiency
-  // and cache coherence, at the cost of wasted memory.
-  std::vector<Expression> m_tail;
+  // and cache coherence, at the cost of wasted memory. It is kept with
+  // the properties in a body shared between copies, null when both are empty.
+  struct Body;
+  std::shared_ptr<Body> m_body;
 
-  // convenience typedef
-  typedef std::vector<Expression>::iterator IteratorType;
-  
-  std::map <std::string, Expression> m_property;
+  // read access to the tail, an empty container when there is no body
+  const std::vector<Expression> & tailList() const noexcept;
+
+  // write access to the body, copying it first when it is shared
+  Body & editBody();
+
+  // in debug builds, check the tail is not lent out after the body was hashed
+  void assertNotHashed() const noexcept;
+
+  // hashes of the tail and properties of the body, which must exist
+  std::uint64_t bodyHash() const noexcept;
+  std::uint64_t bodyShape() const noexcept;
+
+  // a map or filter whose loop runs inside the loop of the enclosing map,
+  // filter or reduce, so no intermediate list is built
+  struct Stage {
+    bool filter;
+    Atom procedure;
+  };
+
+  // true if exp is a well formed map or filter call that can be fused
+  static bool isFusableStage(const Expression & exp);
+
+  // evaluate the list argument of a pipeline, collecting the map and filter
+  // calls nested in it as stages, innermost last
+  static Expression evalPipelineSource(const Expression & source, Environment & env, std::vector<Stage> & stages);
+
+  // pass value through the stages, false if a filter dropped it
+  static bool runStages(const std::vector<Stage> & stages, Expression & value, Environment & env);
 
   // internal helper methods
-  Expression handle_lookup(const Atom & head, const Environment & env);
-  Expression handle_define(Environment & env);
-  Expression handle_begin(Environment & env);
-  Expression handle_lambda(Environment & env);
-  Expression handle_apply(Environment & env);
-  Expression handle_map(Environment & env);
-  Expression handle_setprop(Environment & env);
-  Expression handle_getprop(Environment & env);
-  Expression handle_continuousplot(Environment & env);
+  Expression handle_lookup(const Atom & head, const Environment & env) const;
+  Expression handle_define(Environment & env) const;
+  Expression handle_begin(Environment & env) const;
+  Expression handle_lambda(Environment & env) const;
+  Expression handle_apply(Environment & env) const;
+  Expression handle_map(Environment & env) const;
+  Expression handle_filter(Environment & env) const;
+  Expression handle_reduce(Environment & env) const;
+  Expression handle_setprop(Environment & env) const;
+  Expression handle_getprop(Environment & env) const;
+  Expression handle_continuousplot(Environment & env) const;
 };
 /// 
 
+/*! \struct Rewrite
+\brief An optimized form of an expression with the assumptions it relies on.
+ */
+struct Rewrite
+{
+  /// the result if isValue, otherwise an expression evaluated instead
+  Expression replacement;
+  bool isValue = false;
+
+  /// valid only while pi, e and I keep their built-in values
+  bool usesConstants = false;
+
+  /// if a symbol, valid only while it is bound to lambda
+  Atom procedure;
+  Expression lambda;
+};
 
-/// Render expression to output stream
+/// Render expression to output stream, see ResultWriter
 std::ostream & operator<<(std::ostream & out, const Expression & exp);
 
 /// inequality comparison for two expressions (recursive)
@@ -149,10 +312,10 @@ bool operator!=(const Expression & left, const Expression & right) noexcept;
 /*********************** helper function *************************/
 /******************************************************************/
 Expression makePoint(double x, double y, double point_size);
-Expression makeLine(Expression point1, Expression point2);
-void get_borderLine(std::unordered_map<std::string, double> data, Expression & result);
-std::unordered_map<std::string, double> checkAndScalePoints(Expression points);
-double getTextScale(Expression options);
-double getTextScale(Expression options);
-void checkAndMakeOptionList(Expression option, Expression & result, double text_scale, std::unordered_map<std::string, double> data);
-void addAlAuOlOu(std::unordered_map<std::string, double> data, Expression & result, double text_scale);
+Expression makeLine(const Expression & point1, const Expression & point2);
+Expression makeText(std::string text_message, Expression position, double scale, double rotaion);
+void get_borderLine(const PlotBounds & bounds, Expression & result);
+PlotBounds checkAndScalePoints(Expression::ConstIteratorType begin, Expression::ConstIteratorType end);
+double getTextScale(const Expression & options);
+void checkAndMakeOptionList(const Expression & option, Expression & result, double text_scale, const PlotBounds & bounds);
+void addAlAuOlOu(const PlotBounds & bounds, Expression & result, double text_scale);
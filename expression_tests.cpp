@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include "expression.hpp"
+#include "semantic_error.hpp"
 
 TEST_CASE( "Test default expression", "[expression]" ) {
 
@@ -46,3 +47,172 @@ TEST_CASE("Test Head and Tail of Expression", "[expression]")
 	exp2.pushback(Expression(Atom(5)));
 }
 
+
+TEST_CASE("Test copies share subtrees until modified", "[expression]")
+{
+	Expression list(Atom("list"));
+	for (int i = 0; i < 5; i++)
+		list.pushback(Expression(Atom(double(i))));
+	list.add_property("name", Expression(Atom("\"data\"")));
+
+	Expression copy = list;
+	REQUIRE(copy == list);
+	REQUIRE(&*copy.tailConstBegin() == &*list.tailConstBegin());
+
+	copy.pushback(Expression(Atom(5.)));
+	copy.first_of_tail()->head() = Atom(10.);
+	copy.add_property("name", Expression(Atom(1.)));
+
+	REQUIRE(list.tailSize() == 5);
+	REQUIRE(list.tailAt(0).head() == Atom(0.));
+	REQUIRE(list.getProperty("name") == Expression(Atom("\"data\"")));
+	REQUIRE(copy.tailSize() == 6);
+	REQUIRE(copy.first_of_tail()->head() == Atom(10.));
+}
+
+TEST_CASE("Test numeric sequences are computed on demand", "[expression]")
+{
+	Expression sequence = Expression::makeSequence(0, 0.1, 11);
+
+	REQUIRE(sequence.isHeadSymbol());
+	REQUIRE(sequence.head().asSymbol() == "list");
+	REQUIRE(sequence.tailSize() == 11);
+	REQUIRE(sequence.tailAt(10).head().asNumber() == 1.0);
+
+	Expression rest = sequence.tailFrom(1);
+	REQUIRE(rest.tailSize() == 10);
+	REQUIRE(rest.tailAt(0).head().asNumber() == 0.1);
+
+	Expression list(Atom("list"));
+	for (int k = 0; k <= 10; k++)
+		list.pushback(Expression(Atom(k * 0.1)));
+	REQUIRE(sequence == list);
+
+	// modifying a copy materializes it and leaves the original alone
+	Expression copy = sequence;
+	copy.pushback(Expression(Atom(2.)));
+	REQUIRE(copy.tailSize() == 12);
+	REQUIRE(sequence.tailSize() == 11);
+
+	REQUIRE(Expression::makeSequence(1, 1, 0).isTailEmpty());
+}
+
+TEST_CASE("Test plot bounds of a point list", "[expression]")
+{
+	Expression points(Atom("list"));
+	points.pushback(makePoint(-1, 4, 0));
+	points.pushback(makePoint(3, -6, 0));
+	points.pushback(makePoint(1, 2, 0));
+
+	PlotBounds bounds = checkAndScalePoints(points.tailConstBegin(), points.tailConstEnd());
+	REQUIRE(bounds.xMin == -1);
+	REQUIRE(bounds.xMax == 3);
+	REQUIRE(bounds.yMin == -6);
+	REQUIRE(bounds.yMax == 4);
+	REQUIRE(bounds.xScale == BOXSCALE / 4.0);
+	REQUIRE(bounds.yScale == BOXSCALE / 10.0);
+	REQUIRE(bounds.left() == -5);
+	REQUIRE(bounds.right() == 15);
+	REQUIRE(bounds.top() == -8);
+	REQUIRE(bounds.bottom() == 12);
+
+	Expression bad(Atom("list"));
+	bad.pushback(Expression(Atom(1.)));
+	REQUIRE_THROWS_AS(checkAndScalePoints(bad.tailConstBegin(), bad.tailConstEnd()), const SemanticError &);
+}
+
+TEST_CASE("Test graphics properties are kept in slots", "[expression]")
+{
+	Expression point = makePoint(1, 2, 0.5);
+	REQUIRE(point.graphicKind() == PointGraphic);
+	REQUIRE(point.graphicSlot(SizeSlot) == 0.5);
+	REQUIRE(point.propertySize() == 2);
+
+	Atom name("point"); name.setStringType();
+	REQUIRE(point.getProperty("object-name") == Expression(name));
+	REQUIRE(point.getProperty("size") == Expression(Atom(0.5)));
+
+	// values that do not fit a slot are kept as they are
+	Atom big("big"); big.setStringType();
+	point.add_property("size", Expression(big));
+	REQUIRE(point.getProperty("size") == Expression(big));
+	REQUIRE(point.graphicSlot(SizeSlot) == 0);
+	REQUIRE(point.propertySize() == 2);
+
+	Atom other("circle"); other.setStringType();
+	point.add_property("object-name", Expression(other));
+	REQUIRE(point.graphicKind() == NoGraphic);
+	REQUIRE(point.getProperty("object-name") == Expression(other));
+
+	point.add_property("size", Expression(Atom(3.)));
+	point.add_property("color", Expression(Atom(1.)));
+	REQUIRE(point.graphicSlot(SizeSlot) == 3);
+	REQUIRE(point.getProperty("color") == Expression(Atom(1.)));
+	REQUIRE(point.propertySize() == 3);
+
+	Expression text = makeText("label", makePoint(0, 0, 0), 2, 0);
+	REQUIRE(text.graphicKind() == TextGraphic);
+	REQUIRE(text.graphicPosition() != nullptr);
+	REQUIRE(text.graphicPosition()->graphicKind() == PointGraphic);
+	REQUIRE(text.getProperty("text-scale") == Expression(Atom(2.)));
+	REQUIRE(text.getProperty("missing") == Expression());
+}
+
+TEST_CASE("Test structural hashes", "[expression]")
+{
+	auto build = [](double last) {
+		Expression list(Atom("list"));
+		for (int i = 0; i < 99; i++)
+			list.pushback(makePoint(i, 2 * i, 0));
+		list.pushback(makePoint(99, last, 0));
+		return list;
+	};
+
+	Expression a = build(198), b = build(198);
+	REQUIRE(a.hash() == b.hash());
+	REQUIRE(a.shapeHash() == b.shapeHash());
+	REQUIRE(a == b);
+
+	// numbers within the tolerance of operator== have the same shape only
+	Expression close = build(198 + 1e-9);
+	REQUIRE(close.hash() != a.hash());
+	REQUIRE(close.shapeHash() == a.shapeHash());
+	REQUIRE(close == a);
+
+	// hashes follow modifications, copies keep theirs
+	Expression copy = a;
+	copy.pushback(Expression(Atom(1.)));
+	REQUIRE(copy.hash() != a.hash());
+	REQUIRE(copy.shapeHash() != a.shapeHash());
+	REQUIRE(copy != a);
+	REQUIRE(a.hash() == b.hash());
+
+	Expression labeled = a;
+	labeled.add_property("note", Expression(Atom(1.)));
+	REQUIRE(labeled.hash() != a.hash());
+	REQUIRE(labeled.shapeHash() == a.shapeHash());
+
+	// a copy of a hashed tree gets bodies of its own down to the change
+	Expression edited = a;
+	edited.tail()->first_of_tail()->head() = Atom(-1.);
+	REQUIRE(edited.hash() != a.hash());
+	REQUIRE(edited != a);
+	REQUIRE(a.hash() == b.hash());
+	REQUIRE(a == b);
+
+	Atom name("x"), text("x"); text.setStringType();
+	REQUIRE(Expression(name).shapeHash() != Expression(text).shapeHash());
+	REQUIRE(Expression(Atom(1.)).hash() != Expression(Atom(2.)).hash());
+	REQUIRE(Expression(Atom(1.)).shapeHash() == Expression(Atom(2.)).shapeHash());
+
+	// a sequence hashes like the list it stands for
+	Expression sequence = Expression::makeSequence(0, 0.5, 100);
+	Expression explicitList(Atom("list"));
+	for (int k = 0; k < 100; k++)
+		explicitList.append(Atom(0.5 * k));
+	REQUIRE(sequence.hash() == explicitList.hash());
+	REQUIRE(sequence.shapeHash() == explicitList.shapeHash());
+	REQUIRE(sequence == explicitList);
+	REQUIRE(sequence != Expression::makeSequence(0, 0.5, 99));
+	REQUIRE(sequence != Expression::makeSequence(0, 1, 100));
+}
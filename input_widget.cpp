@@ -3,13 +3,42 @@
 InputWidget::InputWidget(QWidget * parent) : QPlainTextEdit(parent)
 {
 	this->setObjectName("input");
+
+	liveTimer = new QTimer(this);
+	liveTimer->setSingleShot(true);
+	QObject::connect(this, SIGNAL(textChanged()), this, SLOT(restartLiveTimer()));
+	QObject::connect(liveTimer, SIGNAL(timeout()), this, SLOT(emitEdited()));
+}
+
+void InputWidget::setLiveMode(bool enabled, int debounce)
+{
+	live = enabled;
+	liveTimer->setInterval(debounce);
+	if (!live)
+		liveTimer->stop();
+}
+
+void InputWidget::restartLiveTimer()
+{
+	if (live)
+		liveTimer->start();
+}
+
+void InputWidget::emitEdited()
+{
+	emit Edited(this->toPlainText().toUtf8().constData());
 }
 
 void InputWidget::keyPressEvent(QKeyEvent * e)
 {
-	if ((e->key() == Qt::Key_Return) && (e->modifiers() == Qt::ShiftModifier))
+	bool submit = (e->key() == Qt::Key_Return) && (e->modifiers() == Qt::ShiftModifier);
+	if (submit)
 	{
 		emit Changed(this->toPlainText().toUtf8().constData());
 	}
 	QPlainTextEdit::keyPressEvent(e);
-}
\ No newline at end of file
+
+	// the submitted cell supersedes a pending speculation, also the one the newline would start
+	if (submit)
+		liveTimer->stop();
+}
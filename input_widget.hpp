@@ -2,17 +2,28 @@
 #define INPUT_WIDGET_HPP
 #include <QPlainTextEdit>
 #include <QObject>
+#include <QTimer>
 #include <string>
 class InputWidget : public QPlainTextEdit
 {
 	Q_OBJECT
 private:
+	// restarted by every edit in live mode, fires once typing pauses
+	QTimer * liveTimer;
+	bool live = false;
 public:
 	InputWidget(QWidget * parent = nullptr);
+
+	/// in live mode Edited is emitted once typing pauses for debounce milliseconds
+	void setLiveMode(bool enabled, int debounce);
 protected:
 	void keyPressEvent(QKeyEvent *e);
 signals:
 	void Changed(std::string Text); // connect to process in noteapp
+	void Edited(std::string Text); // connect to speculate in noteapp
+private slots:
+	void restartLiveTimer();
+	void emitEdited();
 };
 
 
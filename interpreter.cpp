@@ -1,6 +1,7 @@
 #include "interpreter.hpp"
 
 // system includes
+#include <chrono>
 #include <stdexcept>
 
 // module includes
@@ -9,23 +10,57 @@
 #include "expression.hpp"
 #include "environment.hpp"
 #include "semantic_error.hpp"
+#include "optimizer.hpp"
+
+Interpreter::Interpreter(const Environment & start) : env(start) {}
 
 bool Interpreter::parseStream(std::istream & expression) noexcept{
 
   TokenSequenceType tokens = tokenize(expression);
   // this will be now tokens = OPEN + 2 3 CLOSE. Each string is stored inside a single tokent
-  ast = parse(tokens);
-
-  return (ast != Expression());
+  return parse(tokens, ast);
 };
 				     
 
 Expression Interpreter::evaluate(){
 
-  return ast.eval(env);
+  std::uint64_t key = 0;
+  bool cacheable = cache && resultCacheKey(ast, env, key);
+
+  Expression result;
+  if (cacheable && cache->lookup(key, result))
+    return result;
+
+  auto start = std::chrono::steady_clock::now();
+
+  if (optimizing)
+    result = optimize(ast, env).eval(env);
+  else
+    result = ast.eval(env);
+
+  // only reached if the evaluation completed, errors and interrupts throw
+  if (cacheable)
+    cache->store(key, result, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+  return result;
 }
 
 void Interpreter::setInterrupSig(MessageQueueStr * signal)
 {
 	env.setInterruptSignal(signal);
 }
+
+const Environment & Interpreter::environment() const noexcept
+{
+	return env;
+}
+
+void Interpreter::setResultCache(std::shared_ptr<ResultCache> cache) noexcept
+{
+	this->cache = cache;
+}
+
+void Interpreter::setOptimization(bool enabled) noexcept
+{
+	optimizing = enabled;
+}
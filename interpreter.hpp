@@ -9,11 +9,13 @@ It maintains an environment during evaluation.
 
 // system includes
 #include <istream>
+#include <memory>
 #include <string>
 
 // module includes
 #include "environment.hpp"
 #include "expression.hpp"
+#include "result_cache.hpp"
 
 /*! \class Interpreter
 \brief Class to parse and evaluate an expression (program)
@@ -25,6 +27,14 @@ The eval method updates Environment and returns last result.
 class Interpreter {
 public:
 
+  /// construct with the default environment
+  Interpreter() = default;
+
+  /*! Construct starting from an existing environment, e.g. a startup snapshot.
+    \param start the environment to copy, its definitions are shared until modified
+   */
+  explicit Interpreter(const Environment & start);
+
   /*! Parse into an internal Expression from a stream
     \param expression the raw text stream repreenting the candidate expression
     \return true on successful parsing 
@@ -39,6 +49,19 @@ public:
 
   void setInterrupSig(MessageQueueStr * signal);
 
+  /*! Enable or disable the optimization pass run before evaluation, see optimizer.hpp.
+    \param enabled true (the default) to optimize
+   */
+  void setOptimization(bool enabled) noexcept;
+
+  /*! Look up and store the results of pure programs in a cache, see result_cache.hpp.
+    \param cache the cache, possibly shared with other interpreters, nullptr (the default) disables caching
+   */
+  void setResultCache(std::shared_ptr<ResultCache> cache) noexcept;
+
+  /// the current environment, e.g. to snapshot it
+  const Environment & environment() const noexcept;
+
 private:
 
   // the environment
@@ -46,6 +69,12 @@ private:
 
   // the AST
   Expression ast;
+
+  // run the optimizer before evaluating
+  bool optimizing = true;
+
+  // results of earlier evaluations, may be null
+  std::shared_ptr<ResultCache> cache;
 };
 
 #endif
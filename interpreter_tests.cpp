@@ -449,6 +449,32 @@ TEST_CASE("Test map with good input", "[interpreter]") {
 	}
 }
 
+TEST_CASE("Test range with many elements", "[interpreter]") {
+
+  {
+    std::string program = "(begin (define r (range 0 1000000 0.5)) (list (length r) (first r) (first (rest r))))";
+    INFO(program);
+    Expression result = run(program);
+    Expression expected(Atom("list"));
+    expected.pushback(Expression(2000001.));
+    expected.pushback(Expression(0.));
+    expected.pushback(Expression(0.5));
+    REQUIRE(result == expected);
+  }
+
+  { // no accumulated error in the last element
+    std::string program = "(length (range 0 1 0.1))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(11.));
+  }
+
+  {
+    std::string program = "(begin (define inc (lambda (x) (+ x 1))) (length (map inc (range 1 20000 1))))";
+    INFO(program);
+    REQUIRE(run(program) == Expression(20000.));
+  }
+}
+
 TEST_CASE("Test map with bad input", "[interpreter]") {
 	std::vector<std::string> input = { "(map + (list 1 2 3) (list 2 3))",
 										"(map x (list 1 2 3))",
@@ -465,6 +491,67 @@ TEST_CASE("Test map with bad input", "[interpreter]") {
 	}
 }
 
+TEST_CASE("Test filter and reduce", "[interpreter]") {
+
+  {
+    std::string program = "(begin (define big (lambda (x) (> x 2))) (filter big (list 1 4 2 5 3)))";
+    INFO(program);
+    Expression expected(Atom("list"));
+    expected.pushback(Expression(4.));
+    expected.pushback(Expression(5.));
+    expected.pushback(Expression(3.));
+    REQUIRE(run(program) == expected);
+  }
+
+  {
+    std::string program = "(list (reduce + (list 1 2 3 4)) (reduce + 10 (list 1 2)) (reduce max (list 3 7 2)) (reduce + 0 (list)))";
+    INFO(program);
+    Expression expected(Atom("list"));
+    expected.pushback(Expression(10.));
+    expected.pushback(Expression(13.));
+    expected.pushback(Expression(7.));
+    expected.pushback(Expression(0.));
+    REQUIRE(run(program) == expected);
+  }
+
+  { // a fused pipeline gives the same result as its stages run one by one
+    std::string fused = "(begin (define sq (lambda (x) (* x x))) (define low (lambda (x) (< x 500))) "
+                        "(reduce + 0 (map sq (filter low (range 1 1000 1)))))";
+    std::string staged = "(begin (define sq (lambda (x) (* x x))) (define low (lambda (x) (< x 500))) "
+                         "(define a (filter low (range 1 1000 1))) (define b (map sq a)) (reduce + 0 b))";
+    INFO(fused);
+    REQUIRE(run(fused) == Expression(41541750.));
+    REQUIRE(run(fused) == run(staged));
+  }
+
+  { // inner stages report their own errors
+    std::string program = "(begin (define inc (lambda (x) (+ x 1))) (reduce + (map inc (filter inc 3))))";
+    INFO(program);
+    Interpreter interp;
+    std::istringstream iss(program);
+    REQUIRE(interp.parseStream(iss));
+    REQUIRE_THROWS_WITH(interp.evaluate(), "Error during filter: second argument to filter not a list");
+  }
+
+  std::vector<std::string> input = { "(reduce + (list))",
+                                     "(reduce + 1 2 (list 1))",
+                                     "(reduce (list 1) (list 1 2))",
+                                     "(reduce + 3)",
+                                     "(filter + (list 1 2) (list 3))",
+                                     "(filter x (list 1 2 3))",
+                                     "(filter list (list 1 2 3))",
+                                     "(filter - 3)" };
+
+  for (auto a : input)
+  {
+    INFO(a);
+    Interpreter interp;
+    std::istringstream iss(a);
+    REQUIRE(interp.parseStream(iss));
+    REQUIRE_THROWS_AS(interp.evaluate(), const SemanticError &);
+  }
+}
+
 TEST_CASE("Test define with bad input", "[interpreter]") {
 	std::vector<std::string> input = { "(define 2 3)",
 										"(define define 2)",
@@ -0,0 +1,564 @@
+#include "kernel_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+
+#include "parse.hpp"
+#include "plot_stream.hpp"
+#include "result_cache.hpp"
+#include "semantic_error.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// the symbols a program defines and all the symbols it mentions
+void collectSymbols(const Expression & exp, std::set<std::string> & defines, std::set<std::string> & uses)
+{
+	if (exp.isHeadSymbol())
+	{
+		const std::string & name = exp.head().asText();
+		uses.insert(name);
+		if (name == "define" && exp.tailSize() == 2 && exp.first_of_tail()->isHeadSymbol())
+			defines.insert(exp.first_of_tail()->head().asText());
+	}
+
+	for (auto child = exp.tailConstBegin(); child != exp.tailConstEnd(); ++child)
+		collectSymbols(*child, defines, uses);
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+struct KernelPool::Task
+{
+	std::size_t cell = 0;
+	std::size_t order = 0;
+	std::string program;
+	std::set<std::string> defines;
+	std::set<std::string> uses;
+
+	// a re-evaluation, and the submission whose changes caused it; a cell is
+	// re-evaluated at most once per submission, so cycles of definitions end
+	bool rerun = false;
+	std::size_t wave = 0;
+
+	// the cell each needed symbol is taken from
+	std::map<std::string, std::shared_ptr<Task>> imports;
+
+	// cells waiting for this one, and the number of cells this one waits for
+	std::vector<std::shared_ptr<Task>> dependents;
+	std::size_t waiting = 0;
+
+	bool started = false;
+	bool done = false;
+	bool cancelled = false;
+	Cancellation cancellation;
+
+	// a speculative evaluation defines nothing for other cells, and a budget
+	// of zero is unlimited
+	bool speculative = false;
+	std::chrono::milliseconds budget{ 0 };
+
+	// set when a definition imported before it finished changed since, the
+	// wave of that change
+	bool stale = false;
+	std::size_t staleWave = 0;
+
+	// the symbols the evaluation looked up, the hashes of the values it
+	// defined and of the values these replaced
+	std::set<std::string> reads;
+	std::map<std::string, std::uint64_t> definedHashes;
+	std::map<std::string, std::uint64_t> replacedHashes;
+
+	// the environment after evaluation, kept when the cell defines something
+	Environment environment;
+};
+
+KernelPool::KernelPool(const Environment & start, std::size_t kernels, std::function<void()> notify)
+	: m_start(start), m_notify(notify)
+{
+	if (kernels == 0)
+		kernels = std::max(1u, std::thread::hardware_concurrency());
+
+	for (std::size_t i = 0; i < kernels; i++)
+		m_results.emplace_back(new SpscQueue<CellResult>(KERNEL_RESULT_CAPACITY));
+	for (std::size_t i = 0; i < kernels; i++)
+		m_workers.emplace_back(&KernelPool::work, this, i);
+}
+
+KernelPool::~KernelPool()
+{
+	stop();
+}
+
+void KernelPool::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+		for (auto & task : m_unfinished)
+		{
+			task->cancelled = true;
+			task->cancellation.cancel();
+		}
+	}
+	m_readyChanged.notify_all();
+
+	// no kernel takes a cell now, so each pushes at most the result of the
+	// cell it holds; emptying the rings once wakes a kernel waiting for room
+	// and leaves room for that last result, so the workers can be joined
+	drainRings();
+	for (auto & worker : m_workers)
+		worker.join();
+	m_workers.clear();
+
+	// cells not started still reference each other
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto & task : m_unfinished)
+	{
+		task->imports.clear();
+		task->dependents.clear();
+	}
+	m_unfinished.clear();
+	m_ready.clear();
+	m_idle.notify_all();
+}
+
+Environment KernelPool::environment()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Environment env = m_start;
+	for (auto & definer : m_definers)
+	{
+		Atom symbol(definer.first);
+		const Task & task = *definer.second;
+		if (task.done && task.environment.is_exp(symbol))
+			env.add_exp(symbol, task.environment.get_exp(symbol));
+	}
+	return env;
+}
+
+void KernelPool::setResultCache(std::shared_ptr<ResultCache> cache)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_cache = cache;
+}
+
+std::size_t KernelPool::kernels() const noexcept
+{
+	return m_workers.size();
+}
+
+void KernelPool::submit(std::size_t cell, const std::string & program)
+{
+	auto task = std::make_shared<Task>();
+	task->cell = cell;
+	task->program = program;
+
+	Expression ast;
+	std::istringstream in(program);
+	if (!parse(tokenize(in), ast))
+	{
+		CellResult result;
+		result.cell = cell;
+		result.message = "Error: Invalid Expression. Could not parse.";
+		m_stash.push_back(std::move(result));
+		if (m_notify)
+			m_notify();
+		return;
+	}
+	collectSymbols(ast, task->defines, task->uses);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_stopping)
+		return;
+
+	schedule(task);
+	task->wave = task->order;
+	lock.unlock();
+	m_readyChanged.notify_one();
+}
+
+void KernelPool::speculate(std::size_t attempt, const std::string & program, std::chrono::milliseconds budget)
+{
+	// superseded even when the new text does not parse
+	cancelSpeculation();
+
+	auto task = std::make_shared<Task>();
+	task->cell = attempt;
+	task->program = program;
+	task->speculative = true;
+	task->budget = budget;
+
+	Expression ast;
+	std::istringstream in(program);
+	if (!parse(tokenize(in), ast))
+		return;
+	collectSymbols(ast, task->defines, task->uses);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_stopping)
+		return;
+
+	schedule(task);
+	m_speculation = task;
+	lock.unlock();
+	m_readyChanged.notify_one();
+}
+
+void KernelPool::cancelSpeculation()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_speculation)
+		return;
+
+	m_speculation->cancelled = true;
+	m_speculation->cancellation.cancel();
+	m_speculation.reset();
+}
+
+void KernelPool::schedule(const std::shared_ptr<Task> & task)
+{
+	task->order = m_submitted++;
+
+	// the latest definers of the symbols used, and of the symbols their
+	// definitions use, since procedures look symbols up when called
+	std::set<std::string> visited;
+	std::vector<std::string> names(task->uses.begin(), task->uses.end());
+	while (!names.empty())
+	{
+		std::string name = names.back();
+		names.pop_back();
+
+		auto definer = m_definers.find(name);
+		if (!visited.insert(name).second || definer == m_definers.end())
+			continue;
+
+		task->imports[name] = definer->second;
+		names.insert(names.end(), definer->second->uses.begin(), definer->second->uses.end());
+	}
+
+	std::set<Task *> waitingFor;
+	for (auto & import : task->imports)
+	{
+		Task * dependency = import.second.get();
+		if (!dependency->done && waitingFor.insert(dependency).second)
+		{
+			dependency->dependents.push_back(task);
+			task->waiting++;
+		}
+	}
+
+	// a re-evaluation does not take back a symbol another cell defined since
+	for (const std::string & name : task->defines)
+	{
+		if (task->speculative)
+			break;
+
+		std::shared_ptr<Task> & definer = m_definers[name];
+		if (task->rerun && definer && definer->cell != task->cell)
+			continue;
+
+		if (definer && definer->done && definer->definedHashes.count(name))
+			task->replacedHashes[name] = definer->definedHashes[name];
+		definer = task;
+	}
+
+	if (!task->speculative)
+		m_cells[task->cell] = task;
+	m_unfinished.insert(task);
+	if (task->waiting == 0)
+		m_ready.push_back(task);
+}
+
+void KernelPool::rerun(const Task & previous, std::size_t wave)
+{
+	auto task = std::make_shared<Task>();
+	task->cell = previous.cell;
+	task->program = previous.program;
+	task->defines = previous.defines;
+	task->uses = previous.uses;
+	task->rerun = true;
+	task->wave = wave;
+	schedule(task);
+}
+
+void KernelPool::propagate(const Task & task)
+{
+	// the definitions the cell changed and still holds
+	std::set<std::string> changed;
+	for (const std::string & name : task.defines)
+	{
+		auto definer = m_definers.find(name);
+		if (definer == m_definers.end() || definer->second.get() != &task)
+			continue;
+
+		auto before = task.replacedHashes.find(name);
+		auto after = task.definedHashes.find(name);
+		if (before == task.replacedHashes.end() || after == task.definedHashes.end() || before->second != after->second)
+			changed.insert(name);
+	}
+	if (changed.empty())
+		return;
+
+	for (auto & entry : m_cells)
+	{
+		std::shared_ptr<Task> reader = entry.second;
+		if (reader->cell == task.cell || reader->wave == task.wave)
+			continue;
+
+		for (const std::string & name : changed)
+		{
+			if (reader->done && reader->reads.count(name))
+			{
+				rerun(*reader, task.wave);
+				break;
+			}
+
+			// started from the previous definition, re-evaluated when it finishes
+			auto import = reader->imports.find(name);
+			if (!reader->done && import != reader->imports.end() && import->second.get() != &task)
+			{
+				reader->stale = true;
+				reader->staleWave = task.wave;
+				break;
+			}
+		}
+	}
+}
+
+bool KernelPool::tryPop(CellResult & result)
+{
+	if (!m_stash.empty())
+	{
+		result = std::move(m_stash.front());
+		m_stash.pop_front();
+		return true;
+	}
+
+	// start after the ring popped last so no kernel is starved
+	for (std::size_t i = 0; i < m_results.size(); i++)
+	{
+		std::size_t ring = (m_nextRing + i) % m_results.size();
+		if (m_results[ring]->tryPop(result))
+		{
+			m_nextRing = ring + 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+void KernelPool::interrupt()
+{
+	bool stashed = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::shared_ptr<Task>> dropped;
+		for (auto & task : m_unfinished)
+		{
+			task->cancelled = true;
+			task->cancellation.cancel();
+
+			// the cells waiting for a running one are not started either
+			if (task->started)
+				task->dependents.clear();
+			else
+				dropped.push_back(task);
+		}
+
+		// cells not started are taken out of the graph unevaluated, with the
+		// same result as a cell interrupted while running
+		for (auto & task : dropped)
+		{
+			task->imports.clear();
+			task->dependents.clear();
+			task->done = true;
+			m_unfinished.erase(task);
+			if (m_speculation == task)
+				m_speculation.reset();
+
+			if (!task->speculative)
+			{
+				CellResult result;
+				result.cell = task->cell;
+				result.rerun = task->rerun;
+				result.message = "Error: interpreter kernel interrupted";
+				m_stash.push_back(std::move(result));
+				stashed = true;
+			}
+		}
+		m_ready.clear();
+		if (m_unfinished.empty())
+			m_idle.notify_all();
+	}
+
+	if (stashed && m_notify)
+		m_notify();
+}
+
+void KernelPool::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this]() { return m_unfinished.empty(); });
+}
+
+void KernelPool::work(std::size_t kernel)
+{
+	while (true)
+	{
+		std::shared_ptr<Task> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_readyChanged.wait(lock, [this]() { return m_stopping || !m_ready.empty(); });
+			if (m_stopping)
+				return;
+
+			task = m_ready.front();
+			m_ready.pop_front();
+			task->started = true;
+		}
+		CellResult result = run(*task, kernel);
+
+		// a superseded speculation is dropped without a word
+		bool dropped;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			dropped = task->speculative && task->cancelled;
+		}
+		if (!dropped)
+		{
+			m_results[kernel]->push(std::move(result));
+			if (m_notify)
+				m_notify();
+		}
+
+		// the task is finished, release the cells waiting for it and
+		// re-evaluate the ones using definitions it changed
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto & dependent : task->dependents)
+				if (--dependent->waiting == 0)
+					m_ready.push_back(dependent);
+			task->dependents.clear();
+			task->imports.clear();
+
+			if (m_speculation == task)
+				m_speculation.reset();
+
+			if (!task->cancelled && !task->speculative && !m_stopping)
+			{
+				propagate(*task);
+				if (task->stale)
+					rerun(*task, task->staleWave);
+			}
+
+			m_unfinished.erase(task);
+			if (m_unfinished.empty())
+				m_idle.notify_all();
+		}
+		m_readyChanged.notify_all();
+	}
+}
+
+CellResult KernelPool::run(Task & task, std::size_t kernel)
+{
+	CellResult result;
+	result.cell = task.cell;
+	result.rerun = task.rerun;
+	result.speculative = task.speculative;
+
+	Environment env = m_start;
+	for (auto & import : task.imports)
+	{
+		Atom symbol(import.first);
+		const Environment & source = import.second->environment;
+		if (source.is_exp(symbol))
+			env.add_exp(symbol, source.get_exp(symbol));
+	}
+	auto reads = std::make_shared<std::set<std::string>>();
+	env.recordReads(reads);
+	if (task.budget.count() > 0)
+		task.cancellation.setBudget(task.budget);
+	env.setCancellation(&task.cancellation);
+
+	// a large plot is shown while it is still being built, the result of
+	// the cell replaces the chunks
+	std::unique_ptr<PlotStream> stream;
+	if (!task.speculative && !task.rerun)
+	{
+		std::size_t cell = task.cell;
+		stream.reset(new PlotStream([this, cell, kernel](const DrawBuffer & chunk) {
+			CellResult partial;
+			partial.cell = cell;
+			partial.partial = true;
+			partial.commands = chunk;
+			m_results[kernel]->push(std::move(partial));
+			if (m_notify)
+				m_notify();
+		}));
+	}
+
+	Interpreter interp(env);
+	std::istringstream program(task.program);
+	interp.parseStream(program);
+	if (!task.speculative)
+	{
+		// a speculation neither stores its result nor takes a stored one
+		std::lock_guard<std::mutex> lock(m_mutex);
+		interp.setResultCache(m_cache);
+	}
+
+	try
+	{
+		// a speculation runs on every edit, before the text is meant to run
+		Expression ast;
+		std::istringstream text(task.program);
+		if (task.speculative && parse(tokenize(text), ast) && accessesFiles(ast, env))
+			throw SemanticError("Error: files are not read or written while editing");
+
+		result.value = interp.evaluate();
+		buildDrawBuffer(result.value, result.commands);
+		result.ok = true;
+	}
+	catch (const SemanticError & ex)
+	{
+		result.message = ex.what();
+	}
+
+	// other kernels read the environment of a finished cell
+	Environment after = interp.environment();
+	after.recordReads(nullptr);
+	after.setCancellation(nullptr);
+	std::map<std::string, std::uint64_t> hashes;
+	for (const std::string & name : task.defines)
+	{
+		// the cell reading a symbol it defines is not a use of another cell
+		reads->erase(name);
+		Atom symbol(name);
+		if (after.is_exp(symbol))
+			hashes[name] = after.get_exp(symbol).hash();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		task.reads.swap(*reads);
+		task.definedHashes.swap(hashes);
+		if (!task.defines.empty())
+			task.environment = after;
+		task.done = true;
+	}
+	return result;
+}
+
+void KernelPool::drainRings()
+{
+	CellResult result;
+	for (auto & ring : m_results)
+		while (ring->tryPop(result))
+			m_stash.push_back(std::move(result));
+}
@@ -0,0 +1,186 @@
+/*! \file kernel_pool.hpp
+Defines the pool of interpreter kernels evaluating notebook cells.
+
+Every cell is evaluated by an interpreter of its own on one of several
+worker threads, starting from a copy of the startup environment. A cell
+that refers to a symbol defined by an earlier cell waits for that cell and
+gets its definition; the dependency is followed through the bodies of
+procedures, so a procedure can use a symbol defined after it like in a
+single interpreter. Cells that do not depend on each other run at the same
+time.
+
+Every evaluation records the definitions it looked up. When a cell changes
+the value of a definition, the cells that read it are evaluated again and
+their new results delivered, marked as reruns, so a parameter can be swept
+by redefining it.
+
+A cell can also be evaluated speculatively while it is being edited: each
+attempt cancels the previous one and may be given a time budget, and its
+definitions are not seen by other cells.
+
+While a cell builds a plot, chunks of its drawing are delivered ahead of the
+result (see plot_stream.hpp).
+ */
+#ifndef KERNEL_POOL_HPP
+#define KERNEL_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "draw_buffer.hpp"
+#include "interpreter.hpp"
+#include "spsc_queue.hpp"
+
+/// results a kernel holds before it waits for the owner of the pool to take them
+const std::size_t KERNEL_RESULT_CAPACITY = 256;
+
+/*! \struct CellResult
+\brief Outcome of one cell, routed back by its ID.
+ */
+struct CellResult
+{
+	std::size_t cell = 0;
+	bool ok = false;
+
+	/// the value of the cell and its drawing, when ok
+	Expression value;
+	DrawBuffer commands;
+
+	/// the error, when not ok
+	std::string message;
+
+	/// the cell was evaluated again because a definition it used changed
+	bool rerun = false;
+
+	/// the result of a speculation, cell is the ID of the attempt
+	bool speculative = false;
+
+	/// commands of a plot the cell is still building, its result follows
+	bool partial = false;
+};
+
+/*! \class KernelPool
+\brief Worker threads evaluating cells in the order their definitions allow.
+
+Cells are submitted and results popped from the thread owning the pool.
+Results arrive in the order cells finish, which for independent cells need
+not be the order they were submitted in. Every kernel hands its results
+over in a ring of its own, and waits when the ring is full, so the owner
+has to keep taking them.
+ */
+class KernelPool
+{
+public:
+
+	/*! Start the workers.
+	\param start the environment every cell starts from, usually the startup snapshot
+	\param kernels number of worker threads, 0 uses the hardware concurrency
+	\param notify called from a worker whenever a result is ready, may be empty
+	 */
+	KernelPool(const Environment & start, std::size_t kernels = 0, std::function<void()> notify = nullptr);
+
+	/// stop the workers, see stop
+	~KernelPool();
+
+	KernelPool(const KernelPool &) = delete;
+	KernelPool & operator=(const KernelPool &) = delete;
+
+	/// look up and store results in cache, see result_cache.hpp
+	void setResultCache(std::shared_ptr<ResultCache> cache);
+
+	/// evaluate program as cell, after the earlier cells defining symbols it uses
+	void submit(std::size_t cell, const std::string & program);
+
+	/*! Evaluate program speculatively, e.g. while it is still being typed.
+	Its definitions are not kept, its result is dropped once a later
+	speculation supersedes it, and it stops with an error after budget.
+	\param attempt ID of the result, which is marked speculative
+	\param program the text, ignored if it does not parse
+	\param budget the time the evaluation may take, zero is unlimited
+	 */
+	void speculate(std::size_t attempt, const std::string & program, std::chrono::milliseconds budget);
+
+	/// cancel the current speculation, dropping its result unless it was delivered already
+	void cancelSpeculation();
+
+	/// take a finished result, false if there is none
+	bool tryPop(CellResult & result);
+
+	/*! Interrupt the cells being evaluated and drop the ones not started.
+	Every cell, also a dropped one, delivers the error of an interruption.
+	 */
+	void interrupt();
+
+	/// block until every submitted cell has finished
+	void waitIdle();
+
+	/// interrupt the cells being evaluated and stop the workers, cells not started are dropped
+	void stop();
+
+	/// the start environment with the latest definition of every symbol defined by a finished cell
+	Environment environment();
+
+	/// number of worker threads
+	std::size_t kernels() const noexcept;
+
+private:
+	struct Task;
+
+	Environment m_start;
+	std::function<void()> m_notify;
+	std::shared_ptr<ResultCache> m_cache;
+
+	std::mutex m_mutex;
+	std::condition_variable m_readyChanged;
+	std::condition_variable m_idle;
+	bool m_stopping = false;
+
+	// cells whose dependencies have finished, in submission order
+	std::deque<std::shared_ptr<Task>> m_ready;
+
+	// cells submitted and not finished
+	std::set<std::shared_ptr<Task>> m_unfinished;
+
+	// the latest cell defining each symbol, and the latest evaluation of each cell
+	std::map<std::string, std::shared_ptr<Task>> m_definers;
+	std::map<std::size_t, std::shared_ptr<Task>> m_cells;
+
+	// the latest speculation while it is unfinished
+	std::shared_ptr<Task> m_speculation;
+
+	std::size_t m_submitted = 0;
+	std::vector<std::thread> m_workers;
+
+	// results of each kernel, the kernel pushing and the owner popping
+	std::vector<std::unique_ptr<SpscQueue<CellResult>>> m_results;
+	std::size_t m_nextRing = 0;
+
+	// results held by the owner: cells that did not parse or were dropped by
+	// an interruption, and results taken out of the rings while stopping
+	std::deque<CellResult> m_stash;
+
+	// worker loop of kernel, and the evaluation of one cell on it
+	void work(std::size_t kernel);
+	CellResult run(Task & task, std::size_t kernel);
+
+	// with m_mutex held: queue task after the cells it needs, queue previous
+	// again, and re-evaluate the cells reading a definition task changed
+	void schedule(const std::shared_ptr<Task> & task);
+	void rerun(const Task & previous, std::size_t wave);
+	void propagate(const Task & task);
+
+	// move the results in the rings to the stash
+	void drainRings();
+};
+
+#endif
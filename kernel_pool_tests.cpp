@@ -0,0 +1,303 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include "kernel_pool.hpp"
+#include "plot_stream.hpp"
+
+// run cells on pool and return their results by cell
+std::map<std::size_t, CellResult> runCells(KernelPool & pool, const std::vector<std::string> & cells)
+{
+	for (std::size_t cell = 0; cell < cells.size(); cell++)
+		pool.submit(cell, cells[cell]);
+	pool.waitIdle();
+
+	std::map<std::size_t, CellResult> results;
+	CellResult result;
+	while (pool.tryPop(result))
+		if (!result.rerun)
+			results[result.cell] = result;
+	REQUIRE(results.size() == cells.size());
+	return results;
+}
+
+TEST_CASE("Test kernel pool routes results by cell", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 4);
+	REQUIRE(pool.kernels() == 4);
+
+	auto results = runCells(pool, {
+		"(define a 2)",
+		"(define f (lambda (x) (* x a)))",
+		"(f 4)",
+		"(define g (lambda (x) (+ x b)))",
+		"(define b 1)",
+		"(g 1)",
+		"(+ 1 2",
+		"(first (list))",
+		"(define a 10)",
+		"(f 1)" });
+
+	REQUIRE(results[2].ok);
+	REQUIRE(results[2].value == Expression(Atom(8.)));
+
+	// a procedure sees a symbol defined after it
+	REQUIRE(results[5].value == Expression(Atom(2.)));
+
+	REQUIRE(!results[6].ok);
+	REQUIRE(results[6].message == "Error: Invalid Expression. Could not parse.");
+	REQUIRE(!results[7].ok);
+
+	// the latest definition is used
+	REQUIRE(results[9].value == Expression(Atom(10.)));
+	REQUIRE(results[9].commands.size() == results[2].commands.size());
+}
+
+TEST_CASE("Test kernel pool runs independent cells concurrently", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 2);
+	pool.submit(0, "(length (map sqrt (range 1 200000 1)))");
+	pool.submit(1, "(+ 1 2)");
+
+	// the cells share no definitions, so both are evaluated without waiting
+	// on each other; the order they finish in depends on the scheduler
+	pool.waitIdle();
+	std::map<std::size_t, CellResult> results;
+	CellResult result;
+	while (pool.tryPop(result))
+		results[result.cell] = result;
+	REQUIRE(results.size() == 2);
+	REQUIRE(results[0].ok);
+	REQUIRE(results[0].value == Expression(Atom(200000.)));
+	REQUIRE(results[1].ok);
+	REQUIRE(results[1].value == Expression(Atom(3.)));
+}
+
+TEST_CASE("Test kernel pool interrupt", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 1);
+	pool.submit(0, "(define n (length (map sqrt (range 1 2000000 1))))");
+	pool.submit(1, "(+ n 1)");
+	pool.submit(2, "(save \"kernel_pool_interrupt.plsb\" 1)");
+	pool.interrupt();
+	pool.waitIdle();
+
+	// the running cell stops at its next check, inside the map as well, and
+	// the cells queued behind it are not evaluated
+	std::map<std::size_t, CellResult> results;
+	CellResult result;
+	while (pool.tryPop(result))
+		results[result.cell] = result;
+	REQUIRE(results.size() == 3);
+	for (auto & interrupted : results)
+	{
+		REQUIRE(!interrupted.second.ok);
+		REQUIRE(interrupted.second.message == "Error: interpreter kernel interrupted");
+	}
+	REQUIRE(!std::ifstream("kernel_pool_interrupt.plsb"));
+
+	// the pool keeps working afterwards
+	pool.submit(3, "(+ 2 2)");
+	pool.waitIdle();
+	REQUIRE(pool.tryPop(result));
+	REQUIRE(result.value == Expression(Atom(4.)));
+}
+
+TEST_CASE("Test kernel pool speculation", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 2);
+	runCells(pool, { "(define a 2)", "(define g (lambda (x) (* x a)))" });
+
+	// a superseded attempt delivers nothing, also when the new text does not parse
+	pool.speculate(1, "(length (map g (range 1 2000000 1)))", std::chrono::milliseconds(0));
+	pool.speculate(2, "(g 2", std::chrono::milliseconds(0));
+	pool.speculate(3, "(begin (define a 5) (g 3))", std::chrono::milliseconds(0));
+	pool.waitIdle();
+
+	CellResult result;
+	REQUIRE(pool.tryPop(result));
+	REQUIRE(result.speculative);
+	REQUIRE(result.cell == 3);
+	REQUIRE(result.value == Expression(Atom(15.)));
+	REQUIRE(!pool.tryPop(result));
+
+	// its definitions are not kept
+	REQUIRE(pool.environment().get_exp(Atom("a")) == Expression(Atom(2.)));
+
+	// an attempt running out of time stops with an error
+	pool.speculate(4, "(length (map g (range 1 100000000 1)))", std::chrono::milliseconds(20));
+	pool.waitIdle();
+	REQUIRE(pool.tryPop(result));
+	REQUIRE(result.cell == 4);
+	REQUIRE(!result.ok);
+	REQUIRE(result.message == "Error: evaluation exceeded its time limit");
+
+	pool.speculate(5, "(length (map g (range 1 100000000 1)))", std::chrono::milliseconds(0));
+	pool.cancelSpeculation();
+	pool.waitIdle();
+	REQUIRE(!pool.tryPop(result));
+
+	// files are not touched, also not through a procedure
+	pool.submit(2, "(define keep (lambda (x) (save \"kernel_pool_speculation.plsb\" x)))");
+	pool.waitIdle();
+	REQUIRE(pool.tryPop(result));
+	pool.speculate(6, "(keep 1)", std::chrono::milliseconds(0));
+	pool.waitIdle();
+	REQUIRE(pool.tryPop(result));
+	REQUIRE(result.cell == 6);
+	REQUIRE(!result.ok);
+	REQUIRE(result.message == "Error: files are not read or written while editing");
+	REQUIRE(!std::ifstream("kernel_pool_speculation.plsb"));
+}
+
+TEST_CASE("Test kernel pool streams plots ahead of the result", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 2);
+	pool.submit(0, "(begin (define f (lambda (x) (list x (* x x)))) (discrete-plot (map f (range 0 9999 1)) (list)))");
+	pool.waitIdle();
+
+	std::size_t partials = 0, streamed = 0;
+	CellResult result;
+	while (pool.tryPop(result) && result.partial)
+	{
+		REQUIRE(result.cell == 0);
+		partials++;
+		streamed += result.commands.size();
+	}
+	REQUIRE(!result.partial);
+	REQUIRE(result.ok);
+	REQUIRE(partials > 1);
+	// all but the last chunk, which the result delivers anyway
+	REQUIRE(streamed <= result.commands.size());
+	REQUIRE(streamed + PLOT_STREAM_CHUNK >= 2 * 10000);
+	REQUIRE(!pool.tryPop(result));
+}
+
+TEST_CASE("Test kernel pool stops while its results are not taken", "[kernel_pool]")
+{
+	std::atomic<std::size_t> published(0);
+	KernelPool pool(Environment(), 1, [&published]() { published++; });
+	for (std::size_t cell = 0; cell < KERNEL_RESULT_CAPACITY + 10; cell++)
+		pool.submit(cell, "(+ 1 2)");
+
+	// the kernel fills its ring and waits for room
+	while (published < KERNEL_RESULT_CAPACITY)
+		std::this_thread::yield();
+	pool.stop();
+
+	std::size_t count = 0;
+	CellResult result;
+	while (pool.tryPop(result))
+		REQUIRE(result.cell == count++);
+	REQUIRE(count >= KERNEL_RESULT_CAPACITY);
+	REQUIRE(count <= KERNEL_RESULT_CAPACITY + 1);
+}
+
+// submit program as cell and return the results delivered for cells re-evaluated because of it
+std::map<std::size_t, CellResult> rerunsAfter(KernelPool & pool, std::size_t cell, const std::string & program)
+{
+	pool.submit(cell, program);
+	pool.waitIdle();
+
+	std::map<std::size_t, CellResult> reruns;
+	CellResult result;
+	while (pool.tryPop(result))
+	{
+		if (result.rerun)
+			reruns[result.cell] = result;
+		else
+			REQUIRE(result.cell == cell);
+	}
+	return reruns;
+}
+
+TEST_CASE("Test kernel pool re-evaluates cells using a changed definition", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 2);
+	runCells(pool, {
+		"(define a 2)",
+		"(define f (lambda (x) (* x a)))",
+		"(f 4)",
+		"(define b (f 1))",
+		"(+ b 1)",
+		"(list 1 2)" });
+
+	// through f and through b, but not the cell that does not use a
+	auto reruns = rerunsAfter(pool, 6, "(define a 3)");
+	REQUIRE(reruns.size() == 3);
+	REQUIRE(reruns[2].value == Expression(Atom(12.)));
+	REQUIRE(reruns[3].value == Expression(Atom(3.)));
+	REQUIRE(reruns[4].value == Expression(Atom(4.)));
+	REQUIRE(reruns[2].commands.size() == 1);
+
+	// the same value again changes nothing
+	REQUIRE(rerunsAfter(pool, 7, "(define a (+ 1 2))").empty());
+	REQUIRE(rerunsAfter(pool, 8, "(define c 1)").empty());
+
+	// a cell that failed on an unknown symbol is evaluated again once it is defined
+	pool.submit(9, "(first d)");
+	pool.waitIdle();
+	CellResult result;
+	REQUIRE(pool.tryPop(result));
+	REQUIRE(!result.ok);
+	reruns = rerunsAfter(pool, 10, "(define d (list 1))");
+	REQUIRE(reruns.size() == 1);
+	REQUIRE(reruns[9].ok);
+	REQUIRE(reruns[9].value == Expression(Atom(1.)));
+	reruns = rerunsAfter(pool, 11, "(define d (list 5))");
+	REQUIRE(reruns.size() == 1);
+	REQUIRE(reruns[9].value == Expression(Atom(5.)));
+
+	// the parameters of a procedure are not definitions of the cell
+	REQUIRE(rerunsAfter(pool, 12, "(define x 7)").empty());
+}
+
+TEST_CASE("Test kernel pool re-evaluation of cyclic definitions ends", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 2);
+	runCells(pool, { "(define x 1)", "(define y (+ x 1))", "(define x (+ y 1))" });
+	REQUIRE(pool.environment().get_exp(Atom("x")) == Expression(Atom(3.)));
+
+	// y is re-evaluated once, and x is not taken back from the newer cell
+	auto reruns = rerunsAfter(pool, 3, "(define x 10)");
+	REQUIRE(reruns.size() == 2);
+	REQUIRE(reruns[1].value == Expression(Atom(11.)));
+	REQUIRE(reruns[2].value == Expression(Atom(12.)));
+	REQUIRE(pool.environment().get_exp(Atom("x")) == Expression(Atom(10.)));
+	REQUIRE(pool.environment().get_exp(Atom("y")) == Expression(Atom(11.)));
+}
+
+TEST_CASE("Test kernel pool stop interrupts the running cell", "[kernel_pool]")
+{
+	KernelPool pool(Environment(), 1);
+	pool.submit(0, "(length (map sqrt (range 1 100000000 1)))");
+	pool.submit(1, "(+ 1 2)");
+	pool.stop();
+
+	// the cell is interrupted if it had started, the one behind it dropped
+	CellResult result;
+	while (pool.tryPop(result))
+	{
+		REQUIRE(result.cell == 0);
+		REQUIRE(result.message == "Error: interpreter kernel interrupted");
+	}
+}
+
+TEST_CASE("Test kernel pool keeps definitions after stopping", "[kernel_pool]")
+{
+	Environment env;
+	{
+		KernelPool pool(Environment(), 2);
+		runCells(pool, { "(define a 2)", "(define a 3)", "(define f (lambda (x) (* x a)))", "(first (list))" });
+		pool.stop();
+		pool.submit(4, "(f 1)");
+		env = pool.environment();
+	}
+
+	KernelPool restarted(env, 2);
+	auto results = runCells(restarted, { "(f 2)" });
+	REQUIRE(results[0].value == Expression(Atom(6.)));
+}
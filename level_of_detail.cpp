@@ -0,0 +1,120 @@
+#include "level_of_detail.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// vertical extent of every thin line falling in one pixel column
+struct LodColumn
+{
+	double yMin;
+	double yMax;
+	double thickness;
+};
+
+// pack a pixel cell into a single hash key, columns and rows may be negative
+std::uint64_t lodCellKey(long long column, long long row)
+{
+	return (static_cast<std::uint64_t>(column) << 32) ^ static_cast<std::uint32_t>(row);
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+DrawBuffer decimateDrawBuffer(const DrawBuffer & full, double pixelsPerUnit, std::size_t columns)
+{
+	std::size_t primitives = 0;
+	for (auto & command : full)
+	{
+		if (command.kind == DrawCommand::ErrorKind)
+			return full;
+		if (command.kind == DrawCommand::PointKind || command.kind == DrawCommand::LineKind)
+			primitives++;
+	}
+
+	std::size_t budget = std::max(LOD_MIN_PRIMITIVES, columns * LOD_PRIMITIVES_PER_COLUMN);
+	if (primitives <= budget || !(pixelsPerUnit > 0))
+		return full;
+
+	DrawBuffer result;
+	std::map<long long, LodColumn> thin_lines;
+	std::unordered_map<std::uint64_t, std::size_t> point_cells;
+	std::vector<DrawCommand> points;
+
+	for (auto & command : full)
+	{
+		switch (command.kind)
+		{
+		case DrawCommand::LineKind:
+		{
+			if (std::fabs(command.x2 - command.x1) * pixelsPerUnit >= 1)
+			{
+				result.addLine(command.x1, command.y1, command.x2, command.y2, command.size);
+				break;
+			}
+			long long column = static_cast<long long>(std::floor((command.x1 + command.x2) / 2 * pixelsPerUnit));
+			double low = std::min(command.y1, command.y2);
+			double high = std::max(command.y1, command.y2);
+
+			auto found = thin_lines.find(column);
+			if (found == thin_lines.end())
+			{
+				LodColumn extent = { low, high, command.size };
+				thin_lines.emplace(column, extent);
+			}
+			else
+			{
+				found->second.yMin = std::min(found->second.yMin, low);
+				found->second.yMax = std::max(found->second.yMax, high);
+				found->second.thickness = std::max(found->second.thickness, command.size);
+			}
+			break;
+		}
+		case DrawCommand::PointKind:
+		{
+			long long column = static_cast<long long>(std::floor(command.x1 * pixelsPerUnit));
+			long long row = static_cast<long long>(std::floor(command.y1 * pixelsPerUnit));
+			std::uint64_t key = lodCellKey(column, row);
+
+			auto found = point_cells.find(key);
+			if (found == point_cells.end())
+			{
+				point_cells.emplace(key, points.size());
+				points.push_back(command);
+			}
+			else if (points[found->second].size < command.size)
+			{
+				points[found->second] = command;
+			}
+			break;
+		}
+		case DrawCommand::TextKind:
+			result.addText(command.x1, command.y1, command.rotation, command.size, full.textOf(command));
+			break;
+		case DrawCommand::OutputKind:
+			result.addOutput(full.textOf(command));
+			break;
+		case DrawCommand::ErrorKind:
+			break;
+		}
+	}
+
+	for (auto & column : thin_lines)
+	{
+		double x = (column.first + 0.5) / pixelsPerUnit;
+		result.addLine(x, column.second.yMin, x, column.second.yMax, column.second.thickness);
+	}
+
+	for (auto & point : points)
+		result.addPoint(point.x1, point.y1, point.size);
+
+	return result;
+}
@@ -0,0 +1,36 @@
+/*! \file level_of_detail.hpp
+Defines the decimation used to render large plots at screen resolution.
+
+The full DrawBuffer is kept by the caller, only the decimated copy is turned
+into scene items, so zooming in can always recover every data point.
+ */
+#ifndef LEVEL_OF_DETAIL_HPP
+#define LEVEL_OF_DETAIL_HPP
+
+#include <cstddef>
+
+#include "draw_buffer.hpp"
+
+/// below this many points and lines a buffer is always drawn as is
+const std::size_t LOD_MIN_PRIMITIVES = 2000;
+
+/// primitives allowed per pixel column before decimation kicks in
+const std::size_t LOD_PRIMITIVES_PER_COLUMN = 4;
+
+/*! \fn decimateDrawBuffer
+\brief reduce a buffer to roughly one primitive per pixel
+
+Lines narrower than a pixel column are merged into one vertical line per
+column spanning their min and max, points are binned so that each pixel
+keeps only its largest point. Texts, wide lines and messages are kept as
+is. Buffers below the budget, or containing an error, are returned
+unchanged.
+
+\param full the complete buffer
+\param pixelsPerUnit the number of device pixels per scene unit
+\param columns the width of the view in pixels, used to size the budget
+\return the buffer to paint
+ */
+DrawBuffer decimateDrawBuffer(const DrawBuffer & full, double pixelsPerUnit, std::size_t columns);
+
+#endif
@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include "level_of_detail.hpp"
+
+TEST_CASE("Test small buffers are not decimated", "[level_of_detail]")
+{
+	DrawBuffer full;
+	for (int i = 0; i < 100; i++)
+	{
+		full.addPoint(i * 0.001, 1, 0.5);
+		full.addLine(i * 0.001, 1, i * 0.001, 0, 0);
+	}
+
+	DrawBuffer shown = decimateDrawBuffer(full, 1, 100);
+
+	REQUIRE(shown.size() == full.size());
+}
+
+TEST_CASE("Test thin lines are merged per pixel column", "[level_of_detail]")
+{
+	// 100000 stems over 20 units drawn on 200 pixels
+	DrawBuffer full;
+	for (int i = 0; i < 100000; i++)
+	{
+		double x = i * 0.0002;
+		double y = (i % 2 == 0) ? 5 : -3;
+		full.addLine(x, 0, x, y, 0);
+	}
+	full.addLine(0, -3, 20, -3, 1);
+	full.addText(10, -6, 0, 1, "title");
+
+	DrawBuffer shown = decimateDrawBuffer(full, 10, 200);
+
+	REQUIRE(shown.size() <= 203);
+
+	int texts = 0;
+	int wide = 0;
+	for (auto & command : shown)
+	{
+		if (command.kind == DrawCommand::TextKind)
+			texts++;
+		if (command.kind == DrawCommand::LineKind && command.x1 != command.x2)
+			wide++;
+	}
+	REQUIRE(texts == 1);
+	REQUIRE(wide == 1);
+
+	// decimation keeps the extent of the data
+	DrawBounds before = full.bounds();
+	DrawBounds after = shown.bounds();
+	REQUIRE(after.yMin == before.yMin);
+	REQUIRE(after.yMax == before.yMax);
+	REQUIRE(after.xMin >= before.xMin);
+	REQUIRE(after.xMax <= before.xMax + 0.1);
+}
+
+TEST_CASE("Test points are binned per pixel", "[level_of_detail]")
+{
+	DrawBuffer full;
+	for (int i = 0; i < 10000; i++)
+		full.addPoint((i % 100) * 0.01, (i / 100) * 0.01, (i == 0) ? 2 : 0.5);
+
+	// one pixel per unit, all points share the pixel around the origin
+	DrawBuffer shown = decimateDrawBuffer(full, 1, 10);
+
+	REQUIRE(shown.size() == 1);
+	REQUIRE(shown[0].kind == DrawCommand::PointKind);
+	REQUIRE(shown[0].size == 2);
+
+	// zooming in recovers the full data
+	DrawBuffer zoomed = decimateDrawBuffer(full, 1000, 10);
+	REQUIRE(zoomed.size() == full.size());
+
+	// pixels left of and below the origin are binned the same way
+	DrawBuffer mirrored;
+	for (int i = 0; i < 10000; i++)
+		mirrored.addPoint(-0.005 - (i % 100) * 0.01 + (i % 2), -0.005 - (i / 100) * 0.01 + (i % 2), 0.5);
+	REQUIRE(decimateDrawBuffer(mirrored, 1, 10).size() == 2);
+}
+
+TEST_CASE("Test buffers with errors are not decimated", "[level_of_detail]")
+{
+	DrawBuffer full;
+	for (int i = 0; i < 5000; i++)
+		full.addPoint(0, 0, 1);
+	full.addError("diameter of at least one point is negative");
+
+	REQUIRE(decimateDrawBuffer(full, 1, 10).size() == full.size());
+}
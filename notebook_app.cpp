@@ -1,7 +1,9 @@
 #include"notebook_app.hpp"
 #include "semantic_error.hpp"
 #include "startup_config.hpp"
+#include "startup_snapshot.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <fstream>
 #include <iostream>
@@ -10,73 +12,32 @@
 #include <QLayout>
 #include <QDebug>
 
-void NotebookApp::ProcessData(MessageQueueStr & msgIn, MessageQueueData & msgOut, Interpreter & interp)
-{
-	while (1)
-	{
-		std::string popMessage;
-		msgIn.wait_and_pop(popMessage);
-		if (popMessage == "%stop") break;
-		std::istringstream expMsg(popMessage);
-		Data OutputData;
-		if (!interp.parseStream(expMsg))
-		{
-			OutputData.ErrMsg = "Error: Invalid Expression. Could not parse.";
-			OutputData.valid = false;
-			msgOut.push(OutputData);
-		}
-		else
-		{
-			try
-			{
-				Expression exp = interp.evaluate();
-				OutputData.Exp = exp;
-				OutputData.valid = true;
-				msgOut.push(OutputData);
-			}
-			catch (const SemanticError & ex)
-			{
-				OutputData.ErrMsg = ex.what();
-				OutputData.valid = false;
-				msgOut.push(OutputData);
-			}
-		}
-	}
-}
-
-
-
 void NotebookApp::makeConnection()
 {
 	QObject::connect(input, SIGNAL(Changed(std::string)), this, SLOT(process(std::string)));
 	QObject::connect(this, SIGNAL(ClearScene()), output, SLOT(RecieveClearScene()));
 	QObject::connect(this, SIGNAL(ErrorMessage(std::string)), output, SLOT(RecieveError(std::string)));
-	QObject::connect(this, SIGNAL(validOutput(std::string)), output, SLOT(RecieveValidOutput(std::string)));
-	QObject::connect(this, SIGNAL(drawPoint(double, double, double)), output, SLOT(RecieveDrawPoint(double, double, double)));
-	QObject::connect(this, SIGNAL(drawLine(double, double, double, double, double)), output, SLOT(RecieveDrawLine(double, double, double, double , double)));
-	QObject::connect(this, SIGNAL(drawString(double, double, double, double, std::string)), output, SLOT(RecieveDrawString(double, double, double, double, std::string)));
+	QObject::connect(this, SIGNAL(drawCommands(DrawBuffer)), output, SLOT(RecieveDrawCommands(DrawBuffer)));
+	QObject::connect(this, SIGNAL(partialCommands(DrawBuffer)), output, SLOT(RecievePartialCommands(DrawBuffer)));
 	QObject::connect(start, SIGNAL(clicked()), this, SLOT(handleStartButton()));
 	QObject::connect(stop, SIGNAL(clicked()), this, SLOT(handleStopButton()));
 	QObject::connect(reset, SIGNAL(clicked()), this, SLOT(handleResetButton()));
 	QObject::connect(interrupt, SIGNAL(clicked()), this, SLOT(handleInterruptButton()));
+	QObject::connect(live, SIGNAL(toggled(bool)), this, SLOT(handleLiveButton(bool)));
+	QObject::connect(input, SIGNAL(Edited(std::string)), this, SLOT(speculate(std::string)));
 }
 
 void NotebookApp::handleStartButton()
 {
-	if (thRunning == false)
-	{
-		thRunning = true;
-		worker = std::thread(ProcessData, std::ref(msgIn), std::ref(msgOut), std::ref(interp));
-	}
+	if (!kernels)
+		startKernels();
 }
 
 void NotebookApp::handleStopButton()
 {
-	if (thRunning == true)
+	if (kernels)
 	{
-		msgIn.push("%stop");
-		worker.join();
-		thRunning = false;
+		stopKernels();
 	}
 	else
 	{
@@ -86,23 +47,55 @@ void NotebookApp::handleStopButton()
 
 void NotebookApp::handleResetButton()
 {
-	interp = Interpreter();
+	stopKernels();
 	startUp();
-	if (thRunning == false)
-	{
-		thRunning = true;
-		worker = std::thread(ProcessData, std::ref(msgIn), std::ref(msgOut), std::ref(interp));
-	}
+	startKernels();
 }
 
 void NotebookApp::handleInterruptButton()
 {
-	msgIn.push("%stop");
-	interp.setInterrupSig(&InterruptionMessage);
+	if (kernels)
+		kernels->interrupt();
 	emit ErrorMessage("Error: interpreter kernel interrupted");
 }
 
-NotebookApp::NotebookApp(QWidget * parent) : QWidget(parent)
+void NotebookApp::handleLiveButton(bool checked)
+{
+	input->setLiveMode(checked, NOTEBOOK_LIVE_DEBOUNCE_MS);
+	liveAttempt++;
+	if (kernels)
+		kernels->cancelSpeculation();
+}
+
+void NotebookApp::startKernels()
+{
+	kernels.reset(new KernelPool(startEnv, NOTEBOOK_KERNELS, [this]() { notifyResults(); }));
+	kernels->setResultCache(cache);
+}
+
+// running cells are interrupted and the results of cells not shown yet
+// dropped; the definitions of finished cells are kept for the next start
+void NotebookApp::stopKernels()
+{
+	if (!kernels)
+		return;
+
+	kernels->stop();
+	startEnv = kernels->environment();
+	kernels.reset();
+	nextShown = nextCell;
+	finished.clear();
+	reruns.clear();
+}
+
+// called from the kernel threads, wakes the GUI thread once per batch of results
+void NotebookApp::notifyResults()
+{
+	if (!drainPending.exchange(true))
+		QMetaObject::invokeMethod(this, "drainResults", Qt::QueuedConnection);
+}
+
+NotebookApp::NotebookApp(QWidget * parent) : QWidget(parent), drainPending(false)
 {
 	input = new InputWidget(this);
 	output = new OutputWidget(this);
@@ -114,12 +107,16 @@ NotebookApp::NotebookApp(QWidget * parent) : QWidget(parent)
 	reset->setObjectName("reset");
 	interrupt = new QPushButton("Interrupt", this);
 	interrupt->setObjectName("interrupt");
+	live = new QPushButton("Live", this);
+	live->setObjectName("live");
+	live->setCheckable(true);
 
 	auto HQlayout = new QHBoxLayout();
 	HQlayout->addWidget(start);
 	HQlayout->addWidget(stop);
 	HQlayout->addWidget(reset);
 	HQlayout->addWidget(interrupt);
+	HQlayout->addWidget(live);
 
 	auto layout = new QVBoxLayout();
 	layout->addLayout(HQlayout);
@@ -130,110 +127,27 @@ NotebookApp::NotebookApp(QWidget * parent) : QWidget(parent)
 	setLayout(layout);
 	startUp();
 	makeConnection();
-
-	thRunning = true;
-	timer = QObject::startTimer(5);
-	worker = std::thread(ProcessData, std::ref(msgIn), std::ref(msgOut), std::ref(interp));
+	startKernels();
 }
 
 void NotebookApp::startUp()
 {
-	std::ifstream in(STARTUP_FILE);
-	std::string inputLine;
-
-	if (!in)
-	{
-		emit ErrorMessage("Error: Can't open file " + STARTUP_FILE + ".");
-	}
-	else if (!interp.parseStream(in)) {
-		emit ErrorMessage("Error: Invalid Expression.Could not parse.");
-	}
-	else {
-		try {
-			Expression exp = interp.evaluate();
-		}
-		catch (const SemanticError & ex) {
-			emit ErrorMessage(ex.what());
-		}
-	}
-}
-
-void NotebookApp::processPoint(Expression exp)
-{
-	Expression size = exp.getProperty("size");
-	double pointsize = size.head().asNumber();
-	double x = exp.tailConstBegin()->head().asNumber();
-	double y = exp.tail()->head().asNumber();
-
-	if (pointsize < 0)
-	{
-		emit ErrorMessage("diameter of at least one point is negative");
-		return;
-	}
-
-	emit drawPoint(x, y, pointsize);
-}
-
-void NotebookApp::processLine(Expression exp)
-{
-	Expression thickness = exp.getProperty("thickness");
-	double thickness_size = thickness.head().asNumber();
-
-	if (thickness_size < 0)
-	{
-		emit ErrorMessage("thickness of at least a line is negative");
-		return ;
+	try {
+		startEnv = startupEnvironmentFromFile(STARTUP_FILE);
 	}
-
-	double coordinate[4]; int i = 0;
-	auto point1 = exp.tailConstBegin();
-	auto point2 = exp.tail();
-	for (auto a = point1->tailConstBegin(); a != point1->tailConstEnd();a++)
-	{
-		coordinate[i] = a->head().asNumber();
-		i++;
-	}
-	for (auto a = point2->tailConstBegin(); a != point2->tailConstEnd();a++)
-	{
-		coordinate[i] = a->head().asNumber();
-		i++;
-	}
-
-	emit drawLine(coordinate[0], coordinate[1], coordinate[2], coordinate[3], thickness_size);
-}
-
-void NotebookApp::processText(Expression exp)
-{
-	Expression position = exp.getProperty("position");
-	Expression point = position.getProperty("object-name");
-	Expression rotation = exp.getProperty("text-rotation");
-	Expression text_scale = exp.getProperty("text-scale");
-
-	if (point.head().asStringConstant() != "point")
-	{
-		emit ErrorMessage("position of text is not a point");
-		return;
+	catch (const SemanticError & ex) {
+		startEnv = Environment();
+		emit ErrorMessage(ex.what());
 	}
 
-	double x = position.tailConstBegin()->head().asNumber();
-	double y = position.tail()->head().asNumber();
-	double angle = rotation.head().asNumber();
-	double scale = text_scale.head().asNumber();
-
-	if (scale < 1) scale = 1;
-
-	std::string text_message = exp.head().asStringConstant();
-	emit drawString(x, y, angle, scale, text_message);
-
+	// reopened notebooks get the results of unchanged cells back from disk
+	if (!cache)
+		cache = std::make_shared<ResultCache>(RESULT_CACHE_DIR, RESULT_CACHE_BYTES);
 }
 
 NotebookApp::~NotebookApp()
 {
-	if (thRunning == true)
-	{
-		msgIn.push("%stop");
-		worker.join();
-	}
+	stopKernels();
 	delete input;
 	delete output;
 	input = nullptr;
@@ -246,104 +160,97 @@ void NotebookApp::testNoteBook()
 	process(check);
 }
 
-Expression NotebookApp::AnalyzeOutput(const Expression & exp)
+void NotebookApp::process(std::string line)
 {
-	if (exp.isHeadSymbol())
-		if (exp.head().asSymbol() == "lambda")
-			return exp;
+	emit ClearScene();
+	showingCell = false;
 
-	Expression expPropertyType = exp.getProperty("object-name");
+	// a speculation still running is superseded by the cell
+	liveAttempt++;
+	if (kernels)
+		kernels->cancelSpeculation();
 
-	if (exp.head().isNone())
+	if (!line.empty() && kernels)
 	{
-		emit ErrorMessage("NONE");
-		return exp;
+		kernels->submit(nextCell++, line);
 	}
-
-	else if (expPropertyType.head().asStringConstant() == "point")
+	if (!line.empty() && !kernels)
 	{
-		(processPoint(exp));
-		return exp;
+		emit ErrorMessage("Error: interpreter kernel not running");
 	}
+}
+
+// errors while typing are not shown, the last good plot stays instead
+void NotebookApp::speculate(std::string line)
+{
+	if (!line.empty() && kernels)
+		kernels->speculate(++liveAttempt, line, std::chrono::milliseconds(NOTEBOOK_LIVE_BUDGET_MS));
+}
+
+void NotebookApp::drainResults()
+{
+	// clear the flag first so a result pushed while draining posts a new wake up
+	drainPending = false;
+	if (!kernels)
+		return;
 
-	else if (expPropertyType.head().asStringConstant() == "line")
+	CellResult result;
+	while (kernels->tryPop(result))
 	{
-		(processLine(exp));
-		return exp;
+		if (result.speculative)
+		{
+			if (result.ok && result.cell == liveAttempt)
+			{
+				emit ClearScene();
+				emit drawCommands(result.commands);
+				showingCell = false;
+			}
+		}
+		else if (result.partial)
+		{
+			// chunks of a plot are previewed when the cell is next to be shown
+			if (result.cell == nextShown)
+				emit partialCommands(result.commands);
+		}
+		else if (result.rerun)
+			reruns.push_back(result);
+		else
+			finished[result.cell] = result;
 	}
 
-	else if (expPropertyType.head().asStringConstant() == "text")
+	for (auto next = finished.find(nextShown); next != finished.end(); next = finished.find(++nextShown))
 	{
-		(processText(exp));
-		return exp;
+		showResult(next->second);
+		shownCell = next->first;
+		showingCell = true;
+		outputs[next->first] = std::move(next->second);
+		finished.erase(next);
 	}
 
-	else if (exp.isHeadSymbol() && (exp.head().asSymbol() == "list") && (exp.propertySize() == 0))
-	 {
-		 if (!exp.isTailEmpty())
-			 for (auto a = exp.tailConstBegin(); a != exp.tailConstEnd(); a++)
-				 AnalyzeOutput(*a);
-	 }
-
-	else
+	// a re-evaluated cell takes the place of its result once the cell itself
+	// was shown, and redraws the output only when it is that cell's
+	auto shown = std::stable_partition(reruns.begin(), reruns.end(),
+		[this](const CellResult & rerun) { return rerun.cell < nextShown; });
+	for (auto rerun = reruns.begin(); rerun != shown; ++rerun)
 	{
-		std::ostringstream text;
-		text << exp;
-		emit validOutput(text.str());
+		if (showingCell && rerun->cell == shownCell)
+		{
+			emit ClearScene();
+			showResult(*rerun);
+		}
+		outputs[rerun->cell] = std::move(*rerun);
 	}
-
-	return exp;
+	reruns.erase(reruns.begin(), shown);
 }
 
-//void NotebookApp::process(std::string line)
-//{
-//	emit ClearScene();
-//	if (!line.empty())
-//	{
-//		std::istringstream expression(line);
-//
-//		if (!interp.parseStream(expression))
-//			emit ErrorMessage("Error: Invalid Expression.Could not parse.");
-//		else {
-//			try {
-//				Expression exp = interp.evaluate();
-//					AnalyzeOutput(exp);
-//			}
-//			catch (const SemanticError & ex) {
-//				emit ErrorMessage(ex.what());
-//			}
-//		}
-//	}
-//}
-
-void NotebookApp::process(std::string line)
+void NotebookApp::showResult(const CellResult & result)
 {
-	emit ClearScene();
-	if (!line.empty() && thRunning == true)
+	if (result.ok)
 	{
-		Data result;
-		msgIn.push(line);
+		emit drawCommands(result.commands);
 	}
-	if (!line.empty() && !worker.joinable()) // thread is not working
+	else
 	{
-		emit ErrorMessage("Error: interpreter kernel not running");
+		emit ErrorMessage(result.message);
 	}
 }
-
-void NotebookApp::timerEvent(QTimerEvent *event) {
-	Data result;
-	if (msgOut.try_pop(result))
-	{
-		if (result.valid)
-		{
-			AnalyzeOutput(result.Exp);
-		}
-		else
-		{
-			emit ErrorMessage(result.ErrMsg);
-		}
-	}
-	else
-		QObject::timerEvent(event);
-
-}
\ No newline at end of file
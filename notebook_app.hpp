@@ -3,22 +3,16 @@
 #include"input_widget.hpp"
 #include"output_widget.hpp"
 #include"interpreter.hpp"
+#include"draw_buffer.hpp"
+#include"kernel_pool.hpp"
 #include <QWidget>
 #include <QPushButton>
-#include <thread>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
 #include "startup_config.hpp"
 
-
-typedef struct
-{
-	Expression Exp;
-	std::string ErrMsg;
-	bool valid = false;
-} Data;
-
-typedef message_queue<std::string> MessageQueueStr;
-typedef message_queue<Data> MessageQueueData;
-
 class NotebookApp : public QWidget
 {
 	Q_OBJECT
@@ -29,34 +23,45 @@ private:
 	QPushButton * stop;
 	QPushButton * reset;
 	QPushButton * interrupt;
-	Interpreter interp;
-	std::thread worker;
-	int timer;
-	bool thRunning = false;
+	QPushButton * live;
+	Environment startEnv;
+	std::shared_ptr<ResultCache> cache;
+	std::unique_ptr<KernelPool> kernels;
+	std::atomic<bool> drainPending;
+
+	// cells are numbered as they are submitted and their results shown in
+	// that order, finished holds results that arrived ahead of their turn and
+	// reruns the results of re-evaluated cells not shown yet
+	std::size_t nextCell = 0;
+	std::size_t nextShown = 0;
+	std::map<std::size_t, CellResult> finished;
+	std::vector<CellResult> reruns;
+
+	// the newest result of every cell shown, re-evaluations included; the
+	// output pane holds the one of shownCell while showingCell is set
+	std::map<std::size_t, CellResult> outputs;
+	std::size_t shownCell = 0;
+	bool showingCell = false;
 
-	MessageQueueStr msgIn;
-	MessageQueueData msgOut;
-	MessageQueueStr InterruptionMessage;
+	// the latest speculation in live mode, only its result is shown and
+	// the last good plot stays until it arrives
+	std::size_t liveAttempt = 0;
 
 	void makeConnection();
-	static void ProcessData(MessageQueueStr & msgIn, MessageQueueData & msgOut, Interpreter & interp);
+	void notifyResults();
+	void showResult(const CellResult & result);
+	void startKernels();
+	void stopKernels();
 public:
 	NotebookApp(QWidget * parent = nullptr);
 	void startUp();
-	Expression AnalyzeOutput(const Expression & exp);
-	void processPoint(Expression exp);
-	void processLine(Expression exp);
-	void processText(Expression exp);
 	~NotebookApp();
 	void testNoteBook();
-	void timerEvent(QTimerEvent *event);
 
 signals:
 	void ErrorMessage(std::string error);
-	void validOutput(std::string message);
-	void drawPoint(double x, double y, double pointsize);
-	void drawLine(double x1, double y1, double x2, double y2, double thickness_size);
-	void drawString(double x, double y, double angle, double scale, std::string text_message);
+	void drawCommands(const DrawBuffer & commands);
+	void partialCommands(const DrawBuffer & commands);
 	void ClearScene();
 	void clicked(bool checked = false);
 private slots:
@@ -65,6 +70,9 @@ private slots:
 	void handleStopButton();
 	void handleResetButton();
 	void handleInterruptButton();
+	void handleLiveButton(bool checked);
+	void speculate(std::string value);
+	void drainResults();
 
 
 };
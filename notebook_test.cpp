@@ -14,6 +14,7 @@ private slots:
   void testFindStopButtonByName();
   void testFindResetButtonByName();
   void testFindInterruptButtonByName();
+  void testFindLiveButtonByName();
   void testChildrenSize();
   void testFindByType();
   void testSendText();
@@ -57,6 +58,13 @@ void NotebookTest::testFindInterruptButtonByName()
 	QVERIFY2(interruptButton, "Could not find input widget with name: 'interrupt'");
 }
 
+void NotebookTest::testFindLiveButtonByName()
+{
+	auto liveButton = NoteApp.findChild<QPushButton *>("live");
+	QVERIFY2(liveButton, "Could not find input widget with name: 'live'");
+	QVERIFY2(liveButton->isCheckable(), "Live button is not checkable");
+}
+
 void NotebookTest::testFindInputByName()
 {
 	auto op = NoteApp.findChild<InputWidget *>("input");
@@ -76,7 +84,7 @@ void NotebookTest::testChildrenSize()
 	auto childrenQPushButton = NoteApp.findChildren<QPushButton *>();
 	QVERIFY2(childrenQPlainText.size() == 1, "Number QPlainText children is not incorrect");
 	QVERIFY2(childrenQgraphic.size() == 1, "Number QGraphicsView children is not incorrect");
-	QVERIFY2(childrenQPushButton.size() == 4, "Number childrenQPushButton children is not incorrect");
+	QVERIFY2(childrenQPushButton.size() == 5, "Number childrenQPushButton children is not incorrect");
 }
 
 void NotebookTest::testFindByType()
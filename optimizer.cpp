@@ -0,0 +1,257 @@
+#include "optimizer.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "semantic_error.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// built-in procedures without side effects, safe to evaluate ahead of time
+bool isFoldableProcedure(const std::string & name)
+{
+	static const std::set<std::string> names = {
+		"+", "-", "*", "/", "^", "sqrt", "ln", "sin", "cos", "tan",
+		"real", "imag", "mag", "arg", "conj", "min", "max", "<", ">",
+		"list", "first", "rest", "length", "append", "join", "range", "zip" };
+	return names.count(name) > 0;
+}
+
+// built-in procedures producing numbers, allowed in inlined bodies
+bool isArithmeticProcedure(const std::string & name)
+{
+	static const std::set<std::string> names = {
+		"+", "-", "*", "/", "^", "sqrt", "ln", "sin", "cos", "tan",
+		"real", "imag", "mag", "arg", "conj" };
+	return names.count(name) > 0;
+}
+
+bool isConstantSymbol(const Atom & head)
+{
+	return head.isSymbol() && (head.asSymbol() == "pi" || head.asSymbol() == "e" || head.asSymbol() == "I");
+}
+
+bool isLeaf(const Expression & exp)
+{
+	return exp.isTailEmpty() && !(exp.isHeadSymbol() && exp.head().asSymbol() == "list");
+}
+
+// what the optimizer knows about the value of an expression
+struct Known
+{
+	bool literal = false;
+	bool usesConstants = false;
+	Expression value;
+};
+
+Known literalOf(const Expression & exp)
+{
+	Known known;
+	const Rewrite * rewrite = exp.rewrite();
+
+	if (rewrite != nullptr && rewrite->isValue && !rewrite->procedure.isSymbol())
+	{
+		known.literal = true;
+		known.usesConstants = rewrite->usesConstants;
+		known.value = rewrite->replacement;
+	}
+	else if (isLeaf(exp) && (exp.isHeadNumber() || exp.isHeadComplex() || exp.isHeadStringConstant()))
+	{
+		known.literal = true;
+		known.value = Expression(exp.head());
+	}
+	else if (isLeaf(exp) && isConstantSymbol(exp.head()))
+	{
+		// the value pi, e and I have in a fresh environment
+		known.literal = true;
+		known.usesConstants = true;
+		known.value = Environment().get_exp(exp.head());
+	}
+	return known;
+}
+
+// count nodes of body, stopping early once limit is exceeded
+std::size_t countNodes(const Expression & body, std::size_t limit)
+{
+	std::size_t count = 1;
+	for (auto child = body.tailConstBegin(); child != body.tailConstEnd() && count <= limit; ++child)
+		count += countNodes(*child, limit - count);
+	return count;
+}
+
+// true if body is arithmetic on params and literals only, counting parameter uses
+bool isInlinableBody(const Expression & body, const std::map<std::string, std::size_t> & params, std::map<std::string, std::size_t> & uses)
+{
+	if (isLeaf(body))
+	{
+		if (body.isHeadNumber() || body.isHeadStringConstant() || isConstantSymbol(body.head()))
+			return true;
+		if (body.isHeadSymbol() && params.count(body.head().asSymbol()) > 0)
+		{
+			uses[body.head().asSymbol()]++;
+			return true;
+		}
+		return false;
+	}
+
+	if (!body.isHeadSymbol() || !isArithmeticProcedure(body.head().asSymbol()) || body.propertySize() > 0)
+		return false;
+
+	for (auto child = body.tailConstBegin(); child != body.tailConstEnd(); ++child)
+		if (!isInlinableBody(*child, params, uses))
+			return false;
+	return true;
+}
+
+// copy of body with every parameter leaf replaced by its argument
+Expression substitute(const Expression & body, const std::map<std::string, std::size_t> & params, const std::vector<Expression> & args)
+{
+	if (isLeaf(body))
+	{
+		if (body.isHeadSymbol())
+		{
+			auto param = params.find(body.head().asSymbol());
+			if (param != params.end())
+				return args[param->second];
+		}
+		return body;
+	}
+
+	Expression result(body.head());
+	for (auto child = body.tailConstBegin(); child != body.tailConstEnd(); ++child)
+		result.pushback(substitute(*child, params, args));
+	return result;
+}
+
+Expression optimizeNode(const Expression & exp, const Environment & env);
+
+// the body of call inlined, or a NONE expression if it cannot be
+Expression inlineCall(const Expression & call, const std::vector<Expression> & args, const Environment & env)
+{
+	Expression lambda = env.get_UserDefineProc(call.head());
+	if (lambda.tailSize() != 2)
+		return Expression();
+
+	const Expression & paramList = *lambda.tailConstBegin();
+	const Expression & body = *lambda.tail();
+
+	// the parameter list is (list x y ...), made by Environment::make_list
+	std::map<std::string, std::size_t> params;
+	for (auto param = paramList.tailConstBegin(); param != paramList.tailConstEnd(); ++param)
+	{
+		const Atom & name = param->head();
+		if (!name.isSymbol() || isConstantSymbol(name) || params.count(name.asSymbol()) > 0)
+			return Expression();
+		std::size_t index = params.size();
+		params.emplace(name.asSymbol(), index);
+	}
+
+	if (params.size() != args.size() || countNodes(body, INLINE_MAX_NODES) > INLINE_MAX_NODES)
+		return Expression();
+
+	// arguments are evaluated exactly once by a call, so only lookups and literals may be duplicated
+	for (auto & arg : args)
+		if (!isLeaf(arg))
+			return Expression();
+
+	std::map<std::string, std::size_t> uses;
+	if (!isInlinableBody(body, params, uses) || uses.size() != params.size())
+		return Expression();
+
+	return optimizeNode(substitute(body, params, args), env);
+}
+
+// optimize the children of exp at the given tail positions, the others are kept as they are
+Expression optimizeChildren(const Expression & exp, const Environment & env, std::size_t first, std::size_t last)
+{
+	Expression result(exp.head());
+	std::size_t index = 0;
+	for (auto child = exp.tailConstBegin(); child != exp.tailConstEnd(); ++child, ++index)
+	{
+		if (index >= first && index <= last)
+			result.pushback(optimizeNode(*child, env));
+		else
+			result.pushback(*child);
+	}
+	return result;
+}
+
+Expression optimizeNode(const Expression & exp, const Environment & env)
+{
+	if (isLeaf(exp) || exp.propertySize() > 0 || !exp.isHeadSymbol())
+		return exp;
+
+	const std::string & name = exp.head().asSymbol();
+	const std::size_t all = exp.tailSize();
+
+	// special forms, only the positions they evaluate are optimized
+	if (name == "begin")
+		return optimizeChildren(exp, env, 0, all);
+	if (name == "define" || name == "map" || name == "filter" || name == "apply" || name == "get-property")
+		return optimizeChildren(exp, env, 1, 1);
+	if (name == "lambda")
+		return optimizeChildren(exp, env, 1, 1);
+	if (name == "set-property" || name == "continuous-plot" || name == "reduce")
+		return optimizeChildren(exp, env, 1, all);
+
+	Expression result = optimizeChildren(exp, env, 0, all);
+
+	// fold a pure built-in call on literal arguments
+	if (env.is_proc(exp.head()) && isFoldableProcedure(name))
+	{
+		std::vector<Expression> args;
+		bool usesConstants = false;
+		for (auto child = result.tailConstBegin(); child != result.tailConstEnd(); ++child)
+		{
+			Known known = literalOf(*child);
+			if (!known.literal)
+				return result;
+			args.push_back(known.value);
+			usesConstants = usesConstants || known.usesConstants;
+		}
+
+		try
+		{
+			auto rewrite = std::make_shared<Rewrite>();
+			rewrite->replacement = env.get_proc(exp.head())(args);
+			rewrite->isValue = true;
+			rewrite->usesConstants = usesConstants;
+			result.setRewrite(rewrite);
+		}
+		catch (const SemanticError &)
+		{
+			// left for evaluation to report
+		}
+		return result;
+	}
+
+	// inline a small user procedure, guarded by the procedure still being the one bound now
+	if (env.is_userDefine(exp.head()))
+	{
+		std::vector<Expression> args(result.tailConstBegin(), result.tailConstEnd());
+		Expression inlined = inlineCall(result, args, env);
+		if (!inlined.head().isNone())
+		{
+			auto rewrite = std::make_shared<Rewrite>();
+			rewrite->replacement = inlined;
+			rewrite->procedure = exp.head();
+			rewrite->lambda = env.get_UserDefineProc(exp.head());
+			result.setRewrite(rewrite);
+		}
+	}
+
+	return result;
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+Expression optimize(const Expression & program, const Environment & env)
+{
+	return optimizeNode(program, env);
+}
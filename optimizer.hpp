@@ -0,0 +1,32 @@
+/*! \file optimizer.hpp
+Defines the optimization pass run over a parsed program before evaluation.
+
+The pass attaches Rewrites to the nodes of the AST and keeps the nodes
+themselves, so the program prints and compares as written and every
+rewrite can fall back to the original when its assumptions stop holding:
+
+- calls of pure built-in procedures on literal arguments are evaluated
+  once, e.g. (/ 1 3) or (list 0 1),
+- pi, e and I count as literals while they are not redefined,
+- calls of small user procedures whose body only does arithmetic on its
+  parameters are replaced by the body, while the procedure is not redefined.
+ */
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+
+#include "environment.hpp"
+#include "expression.hpp"
+
+/// largest lambda body, in nodes, that is inlined
+const std::size_t INLINE_MAX_NODES = 24;
+
+/*! Optimize a parsed program for evaluation in an environment.
+\param program the parsed program
+\param env the environment the program will be evaluated in
+\return the program with rewrites attached, evaluating to the same result
+ */
+Expression optimize(const Expression & program, const Environment & env);
+
+#endif
@@ -0,0 +1,111 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "optimizer.hpp"
+#include "semantic_error.hpp"
+
+// evaluate every program in turn in one interpreter, recording results or errors
+std::vector<std::string> runSession(const std::vector<std::string> & programs, bool optimized)
+{
+	Interpreter interp;
+	interp.setOptimization(optimized);
+
+	std::vector<std::string> outputs;
+	for (auto & program : programs)
+	{
+		std::istringstream iss(program);
+		std::ostringstream out;
+		if (!interp.parseStream(iss))
+		{
+			out << "parse error";
+		}
+		else
+		{
+			try
+			{
+				out << interp.evaluate();
+			}
+			catch (const SemanticError & ex)
+			{
+				out << ex.what();
+			}
+		}
+		outputs.push_back(out.str());
+	}
+	return outputs;
+}
+
+TEST_CASE("Test optimized and unoptimized evaluation agree", "[optimizer]")
+{
+	std::vector<std::vector<std::string>> sessions = {
+		{ "(+ 1 2 (* 3 4))", "(/ pi 2)", "(^ e 2)", "(* I I)", "(list 0 1 (list))", "(first (list 3 4))" },
+		{ "(define half (lambda (x) (/ x 2)))", "(half 6)", "(define y 10)", "(half y)", "(map half (list 1 2))" },
+		{ "(define f (lambda (x) (* x (/ pi 2))))", "(f 2)", "(define pi 3)", "(f 2)", "(+ pi 1)" },
+		{ "(define g (lambda (x y) (- x y)))", "(g 5 2)", "(define g (lambda (x y) (+ x y)))", "(g 5 2)" },
+		{ "(define sq (lambda (x) (* x x)))", "(define h (lambda (x) (sq (+ x 1))))", "(h 2)",
+		  "(define sq (lambda (x) (+ x x)))", "(h 2)" },
+		{ "(define k (lambda (e) (+ e 1)))", "(k 1)", "(define m (lambda (x) (+ x unknown)))", "(m 1)" },
+		{ "(/ 1 \"a\")", "(first (list))", "(begin (define a 1) (/ a (list)))", "(+ a 1)" },
+		{ "(define p (set-property \"size\" (/ 1 2) (list 0 1)))", "(get-property \"size\" p)", "(lambda (x) (* x (/ pi 2)))" },
+		{ "(begin (define pi 1) (/ pi 2))", "(apply + (list 1 (* 2 3)))", "(range 0 (/ pi 2) 0.5)" },
+	};
+
+	for (auto & session : sessions)
+	{
+		std::vector<std::string> plain = runSession(session, false);
+		std::vector<std::string> optimized = runSession(session, true);
+		for (std::size_t i = 0; i < session.size(); i++)
+		{
+			INFO(session[i]);
+			REQUIRE(optimized[i] == plain[i]);
+		}
+	}
+}
+
+TEST_CASE("Test builtin calls on literals are folded", "[optimizer]")
+{
+	std::istringstream iss("(lambda (x) (* x (/ pi 2) (list 1 2)))");
+	Interpreter interp;
+	REQUIRE(interp.parseStream(iss));
+
+	Expression lambda = interp.evaluate();
+	const Expression & body = *lambda.tail();
+	REQUIRE(body.rewrite() == nullptr);
+
+	auto half_pi = body.tailConstBegin() + 1;
+	REQUIRE(half_pi->rewrite() != nullptr);
+	REQUIRE(half_pi->rewrite()->isValue);
+	REQUIRE(half_pi->rewrite()->usesConstants);
+	REQUIRE(half_pi->rewrite()->replacement == Expression(std::atan2(0, -1) / 2));
+
+	auto pair = body.tailConstBegin() + 2;
+	REQUIRE(pair->rewrite() != nullptr);
+	REQUIRE_FALSE(pair->rewrite()->usesConstants);
+}
+
+TEST_CASE("Test small procedures are inlined", "[optimizer]")
+{
+	std::istringstream definition("(define twice (lambda (x) (* 2 x)))");
+	Interpreter interp;
+	REQUIRE(interp.parseStream(definition));
+	interp.evaluate();
+
+	Expression call(Atom("twice"));
+	call.append(Atom("y"));
+	Expression optimized = optimize(call, interp.environment());
+
+	REQUIRE(optimized == call);
+	REQUIRE(optimized.rewrite() != nullptr);
+	REQUIRE_FALSE(optimized.rewrite()->isValue);
+	REQUIRE(optimized.rewrite()->procedure == Atom("twice"));
+
+	// calls with computed arguments are left alone
+	Expression nested(Atom("twice"));
+	nested.pushback(call);
+	REQUIRE(optimize(nested, interp.environment()).rewrite() == nullptr);
+}
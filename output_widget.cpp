@@ -1,13 +1,26 @@
 #include "output_widget.hpp"
+#include "level_of_detail.hpp"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 OutputWidget::OutputWidget(QWidget * parent) : QWidget(parent)
 {
 	scene = new QGraphicsScene;
+	// items are rebuilt from our own grid whenever the view changes
+	scene->setItemIndexMethod(QGraphicsScene::NoIndex);
 	view = new QGraphicsView(scene);
 	view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 	view->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
 
+	// dragging pans through the hidden scroll bars, each move repaints the visible cells
+	view->setDragMode(QGraphicsView::ScrollHandDrag);
+	QObject::connect(view->horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleRegion()));
+	QObject::connect(view->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleRegion()));
+
+	// the wheel zooms around the mouse instead of scrolling
+	view->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+	view->viewport()->installEventFilter(this);
+
 	auto layout = new QVBoxLayout();
 	layout->addWidget(view);
 	setLayout(layout);
@@ -27,7 +40,24 @@ OutputWidget::~OutputWidget()
 void OutputWidget::resizeEvent(QResizeEvent * event)
 {
 	QWidget::resizeEvent(event); // this is to avoid warning unused variable
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+	refreshLevelOfDetail();
+}
+
+bool OutputWidget::eventFilter(QObject * watched, QEvent * event)
+{
+	if (watched == view->viewport() && event->type() == QEvent::Wheel)
+	{
+		zoom(static_cast<QWheelEvent *>(event)->angleDelta().y() > 0 ? ZOOM_STEP : 1 / ZOOM_STEP);
+		return true;
+	}
+	return QWidget::eventFilter(watched, event);
+}
+
+// scale the view by factor and decimate again for the new resolution
+void OutputWidget::zoom(double factor)
+{
+	view->scale(factor, factor);
+	updateVisibleRegion();
 }
 
 QGraphicsView * OutputWidget::outputBox()
@@ -37,42 +67,164 @@ QGraphicsView * OutputWidget::outputBox()
 
 void OutputWidget::RecieveClearScene()
 {
+	fullCommands.clear();
+	commandIndex.clear();
+	previewCommands.clear();
+	previewBounds = DrawBounds();
 	scene->clear();
+	scene->setSceneRect(QRectF());
 	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
 }
 
 void OutputWidget::RecieveError(std::string error)
 {
+	previewCommands.clear();
+	previewBounds = DrawBounds();
+	fullCommands.clear();
+	fullCommands.addError(error);
+	commandIndex.build(fullCommands);
+	refreshLevelOfDetail();
+}
+
+// the complete result replaces the preview of its chunks
+void OutputWidget::RecieveDrawCommands(const DrawBuffer & commands)
+{
+	previewCommands.clear();
+	previewBounds = DrawBounds();
+	fullCommands.append(commands);
+	commandIndex.build(fullCommands);
+	refreshLevelOfDetail();
+}
+
+// paint a chunk of a plot still being built on top of the scene, until the
+// preview holds as many primitives as a decimated result would
+void OutputWidget::RecievePartialCommands(const DrawBuffer & commands)
+{
+	std::size_t budget = primitiveBudget();
+	if (previewCommands.size() >= budget)
+		return;
+
+	DrawBounds chunk = commands.bounds();
+	if (chunk.valid)
+	{
+		previewBounds.include(chunk.xMin, chunk.yMin);
+		previewBounds.include(chunk.xMax, chunk.yMax);
+	}
+
+	std::size_t columns = std::max(0, view->viewport()->width());
+	DrawBuffer painted = decimateDrawBuffer(commands, pixelsPerUnit(previewBounds), columns);
+	previewCommands.append(painted);
+	paintCommands(painted);
+	fitScene();
+}
+
+// primitives painted at most before decimation, see level_of_detail.hpp
+std::size_t OutputWidget::primitiveBudget() const
+{
+	std::size_t columns = std::max(0, view->viewport()->width());
+	return std::max(LOD_MIN_PRIMITIVES, columns * LOD_PRIMITIVES_PER_COLUMN);
+}
+
+// scale the view would have once fitted to bounds, in pixels per scene unit
+double OutputWidget::pixelsPerUnit(const DrawBounds & bounds) const
+{
+	double width = bounds.xMax - bounds.xMin;
+	double height = bounds.yMax - bounds.yMin;
+	double pixelsWide = view->viewport()->width();
+	double pixelsHigh = view->viewport()->height();
+
+	if (!bounds.valid || (width <= 0 && height <= 0))
+		return 0;
+	if (width <= 0)
+		return pixelsHigh / height;
+	if (height <= 0)
+		return pixelsWide / width;
+
+	return std::min(pixelsWide / width, pixelsHigh / height);
+}
+
+// fit the whole result into the view, then decimate it for the scale the
+// view got; the first pass only serves to find the extent of the items
+void OutputWidget::refreshLevelOfDetail()
+{
+	std::size_t columns = std::max(0, view->viewport()->width());
+
 	scene->clear();
-	scene->addText(QString::fromStdString(error));
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+	paintCommands(decimateDrawBuffer(fullCommands, pixelsPerUnit(fullCommands.bounds()), columns));
+	paintCommands(previewCommands);
+	fitScene();
+	updateVisibleRegion();
 }
 
-void OutputWidget::RecieveValidOutput(std::string message)
+// pin the scene rect so culling items later does not move the view; the
+// scroll bars moving while fitting do not ask for a repaint
+void OutputWidget::fitScene()
 {
-	scene->addText(QString::fromStdString(message));
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+	fitting = true;
+	QRectF extent = scene->itemsBoundingRect();
+	scene->setSceneRect(extent);
+	view->fitInView(extent, Qt::KeepAspectRatio);
+	fitting = false;
+}
+
+// after the view has been zoomed or panned, repaint only what is on screen
+void OutputWidget::updateVisibleRegion()
+{
+	if (fitting)
+		return;
+
+	std::size_t columns = std::max(0, view->viewport()->width());
+	QRectF visible = view->mapToScene(view->viewport()->rect()).boundingRect();
+
+	std::vector<std::size_t> indices;
+	commandIndex.visible(visible.left(), visible.top(), visible.right(), visible.bottom(), indices);
+
+	scene->clear();
+	paintCommands(decimateDrawBuffer(fullCommands.subset(indices), view->transform().m11(), columns));
+	paintCommands(previewCommands);
 }
-#include <QDebug>
-void OutputWidget::RecieveDrawPoint(double x, double y, double pointsize)
+
+void OutputWidget::paintCommands(const DrawBuffer & commands)
+{
+	for (auto & command : commands)
+	{
+		switch (command.kind)
+		{
+		case DrawCommand::PointKind:
+			addPoint(command.x1, command.y1, command.size);
+			break;
+		case DrawCommand::LineKind:
+			addLine(command.x1, command.y1, command.x2, command.y2, command.size);
+			break;
+		case DrawCommand::TextKind:
+			addString(command.x1, command.y1, command.rotation, command.size, commands.textOf(command));
+			break;
+		case DrawCommand::OutputKind:
+			scene->addText(QString::fromStdString(commands.textOf(command)));
+			break;
+		case DrawCommand::ErrorKind:
+			scene->clear();
+			scene->addText(QString::fromStdString(commands.textOf(command)));
+			break;
+		}
+	}
+}
+
+void OutputWidget::addPoint(double x, double y, double pointsize)
 {
-	//check nbounding box
 	QPen blackpen(Qt::black);
 	blackpen.setStyle(Qt::SolidLine);
 	blackpen.setWidth(0);
 	QRectF rec(x - (pointsize / 2), y - (pointsize / 2), pointsize, pointsize); // left top width heigh
-	auto circle = new QGraphicsEllipseItem /*(x,y,pointsize,pointsize)*/;
+	auto circle = new QGraphicsEllipseItem;
 	circle->setPen(blackpen);
 	circle->setBrush(Qt::black);
 	circle->setRect(rec);
 
-
-
 	scene->addItem(circle);
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
 }
 
-void OutputWidget::RecieveDrawLine(double x1, double y1, double x2, double y2, double thickness_size)
+void OutputWidget::addLine(double x1, double y1, double x2, double y2, double thickness_size)
 {
 	auto line = new QGraphicsLineItem(x1,y1,x2,y2);
 	QPen blackpen(Qt::black);	// draw in black color
@@ -80,11 +232,9 @@ void OutputWidget::RecieveDrawLine(double x1, double y1, double x2, double y2, d
 	line->setPen(blackpen);
 
 	scene->addItem(line);
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
 }
 
-
-void OutputWidget::RecieveDrawString(double x, double y, double angle, double scale, std::string text_message)
+void OutputWidget::addString(double x, double y, double angle, double scale, const std::string & text_message)
 { 
 	auto font = QFont("Monospace");
 	font.setStyleHint(QFont::TypeWriter);
@@ -101,8 +251,5 @@ void OutputWidget::RecieveDrawString(double x, double y, double angle, double sc
 	text->setTransformOriginPoint(cntr_point_distance);
 	text->setRotation(angle * 180 / std::atan2(0, -1));
 
-
 	scene->addItem(text);
-	view->fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
 }
-
@@ -6,10 +6,17 @@
 #include <QGraphicsTextItem>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsLineItem>
+#include <QScrollBar>
+#include <QWheelEvent>
 #include <QObject>
 #include <string>
 #include <QPainter>
 #include <QVBoxLayout>
+#include "draw_buffer.hpp"
+#include "spatial_index.hpp"
+/// scale change of one wheel step
+const double ZOOM_STEP = 1.25;
+
 class OutputWidget : public QWidget
 {
 	Q_OBJECT
@@ -17,19 +24,34 @@ class OutputWidget : public QWidget
 private:
 	QGraphicsScene * scene;
 	QGraphicsView * view;
+	DrawBuffer fullCommands;
+	SpatialGrid commandIndex;
+	// what was painted of a result still being computed, and its extent
+	DrawBuffer previewCommands;
+	DrawBounds previewBounds;
+	bool fitting = false;
+	void paintCommands(const DrawBuffer & commands);
+	void fitScene();
+	std::size_t primitiveBudget() const;
+	double pixelsPerUnit(const DrawBounds & bounds) const;
+	void addPoint(double x, double y, double pointsize);
+	void addLine(double x1, double y1, double x2, double y2, double thickness_size);
+	void addString(double x, double y, double angle, double scale, const std::string & text_message);
 public:
 	OutputWidget(QWidget * parent = nullptr);
 	QGraphicsView * outputBox();
 	~OutputWidget();
+	bool eventFilter(QObject * watched, QEvent * event);
 protected:
 	void resizeEvent(QResizeEvent *event);
 public slots:
 	void RecieveClearScene();
 	void RecieveError(std::string error);
-	void RecieveValidOutput(std::string message);
-	void RecieveDrawPoint(double x, double y, double pointsize);
-	void RecieveDrawLine(double x1, double y1, double x2, double y2, double thickness_size);
-	void RecieveDrawString(double x, double y, double angle, double scale, std::string text_message);
+	void RecieveDrawCommands(const DrawBuffer & commands);
+	void RecievePartialCommands(const DrawBuffer & commands);
+	void refreshLevelOfDetail();
+	void updateVisibleRegion();
+	void zoom(double factor);
 };
 
 
@@ -37,10 +37,18 @@ bool append(Expression *exp, const Token &token, bool isstring) {
 Expression parse(const TokenSequenceType &tokens) noexcept {
 
 	Expression ast;
+	parse(tokens, ast);
+	return ast;
+}
+
+bool parse(const TokenSequenceType &tokens, Expression &result) noexcept {
+
+	result = Expression();
+	Expression ast;
 
 	// cannot parse empty
 	if (tokens.empty())
-		return Expression();
+		return false;
 
 	bool athead = false;
 	bool instringconstant = false;
@@ -64,7 +72,7 @@ Expression parse(const TokenSequenceType &tokens) noexcept {
 		}
 		else if (t.type() == Token::CLOSE) {
 			if (stack.empty()) {
-				return Expression();
+				return false;
 			}
 			stack.pop();
 
@@ -78,17 +86,17 @@ Expression parse(const TokenSequenceType &tokens) noexcept {
 			if (athead) {
 				if (stack.empty()) {
 					if (!setHead(ast, t, instringconstant)) {
-						return Expression();
+						return false;
 					}
 					stack.push(&ast);
 				}
 				else {
 					if (stack.empty()) {
-						return Expression();
+						return false;
 					}
 					// if adding a nontype is true
 					if (!append(stack.top(), t, instringconstant)) {
-						return Expression();
+						return false;
 					}
 					stack.push(stack.top()->tail());
 				}
@@ -96,11 +104,11 @@ Expression parse(const TokenSequenceType &tokens) noexcept {
 			}
 			else {
 				if (stack.empty()) {
-					return Expression();
+					return false;
 				}
 
 				if (!append(stack.top(), t, instringconstant)) {
-					return Expression();
+					return false;
 				}
 			}
 		}
@@ -108,8 +116,9 @@ Expression parse(const TokenSequenceType &tokens) noexcept {
 	}
 	// open will make it push into stack and close will make it pop out of stact
 	if (stack.empty() && (num_tokens_seen == tokens.size())) {
-		return ast;
+		result = ast;
+		return true;
 	}
 
-	return Expression();
-};
+	return false;
+}
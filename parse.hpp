@@ -15,4 +15,13 @@ Defines the parse function.
  */
 Expression parse(const TokenSequenceType & tokens) noexcept;
 
+/*! \fn parse
+\brief parse a sequence of tokens, telling whether it succeeded
+
+\param tokens, the input token sequence
+\param result, receives the expression, or the None Expression on failure
+\returns true if the tokens form one complete expression
+ */
+bool parse(const TokenSequenceType & tokens, Expression & result) noexcept;
+
 #endif
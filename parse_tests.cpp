@@ -57,3 +57,19 @@ TEST_CASE( "Test empty parens", "[parse]" ) {
   REQUIRE(parse(tokens) == Expression());
 }
 
+
+TEST_CASE("Test parser reports failure explicitly", "[parse]") {
+
+  std::istringstream good("(list 1 2)");
+  Expression ast;
+  REQUIRE(parse(tokenize(good), ast));
+  REQUIRE(ast.tailSize() == 2);
+
+  std::vector<std::string> bad = { "", "(list 1", "(list 1))", "1", "(1.2abc)" };
+  for (auto program : bad) {
+    INFO(program);
+    std::istringstream iss(program);
+    REQUIRE(!parse(tokenize(iss), ast));
+    REQUIRE(ast == Expression());
+  }
+}
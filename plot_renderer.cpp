@@ -0,0 +1,520 @@
+#include "plot_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// text box of a monospace font at point size 1, in scene units
+const double TEXT_EM = 1.0;
+const double TEXT_ADVANCE = 0.6;
+
+// pixel size of the em of plain output and error messages
+const double MESSAGE_EM = 16;
+
+// 5x7 glyphs for ASCII 32 to 126, one byte per column, bit 0 is the top row
+const unsigned char GLYPHS[95][5] = {
+	{0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00}, {0x14,0x7F,0x14,0x7F,0x14},
+	{0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62}, {0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00},
+	{0x00,0x1C,0x22,0x41,0x00}, {0x00,0x41,0x22,0x1C,0x00}, {0x14,0x08,0x3E,0x08,0x14}, {0x08,0x08,0x3E,0x08,0x08},
+	{0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00}, {0x20,0x10,0x08,0x04,0x02},
+	{0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00}, {0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31},
+	{0x18,0x14,0x12,0x7F,0x10}, {0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03},
+	{0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00}, {0x00,0x56,0x36,0x00,0x00},
+	{0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14}, {0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06},
+	{0x32,0x49,0x79,0x41,0x3E}, {0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+	{0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01}, {0x3E,0x41,0x49,0x49,0x7A},
+	{0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00}, {0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41},
+	{0x7F,0x40,0x40,0x40,0x40}, {0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+	{0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46}, {0x46,0x49,0x49,0x49,0x31},
+	{0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F}, {0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F},
+	{0x63,0x14,0x08,0x14,0x63}, {0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00},
+	{0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04}, {0x40,0x40,0x40,0x40,0x40},
+	{0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78}, {0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20},
+	{0x38,0x44,0x44,0x48,0x7F}, {0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E},
+	{0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00}, {0x7F,0x10,0x28,0x44,0x00},
+	{0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78}, {0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38},
+	{0x7C,0x14,0x14,0x14,0x08}, {0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20},
+	{0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C}, {0x3C,0x40,0x30,0x40,0x3C},
+	{0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C}, {0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00},
+	{0x00,0x00,0x7F,0x00,0x00}, {0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08}
+};
+
+// maps scene coordinates to image pixels, uniform scale like fitInView with KeepAspectRatio
+struct RenderFrame
+{
+	double scale;
+	double offsetX;
+	double offsetY;
+
+	double x(double sceneX) const { return sceneX * scale + offsetX; }
+	double y(double sceneY) const { return sceneY * scale + offsetY; }
+};
+
+// an error clears everything drawn before it, so rendering starts at the last one
+std::size_t firstRenderedCommand(const DrawBuffer & buffer)
+{
+	std::size_t first = 0;
+	for (std::size_t i = 0; i < buffer.size(); i++)
+		if (buffer[i].kind == DrawCommand::ErrorKind)
+			first = i;
+	return first;
+}
+
+RenderFrame fitFrame(const DrawBuffer & buffer, std::size_t first, const RenderOptions & options)
+{
+	DrawBounds bounds;
+	for (std::size_t i = first; i < buffer.size(); i++)
+	{
+		const DrawCommand & command = buffer[i];
+		if (command.kind == DrawCommand::PointKind)
+		{
+			double radius = std::max(command.size, 0.0) / 2;
+			bounds.include(command.x1 - radius, command.y1 - radius);
+			bounds.include(command.x1 + radius, command.y1 + radius);
+		}
+		else if (command.kind == DrawCommand::LineKind)
+		{
+			bounds.include(command.x1, command.y1);
+			bounds.include(command.x2, command.y2);
+		}
+		else if (command.kind == DrawCommand::TextKind)
+		{
+			double halfWidth = buffer.textOf(command).size() * TEXT_ADVANCE * command.size / 2;
+			double halfHeight = TEXT_EM * command.size / 2;
+			double radius = std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight);
+			bounds.include(command.x1 - radius, command.y1 - radius);
+			bounds.include(command.x1 + radius, command.y1 + radius);
+		}
+	}
+
+	double available_width = std::max(1, options.width - 2 * options.margin);
+	double available_height = std::max(1, options.height - 2 * options.margin);
+
+	RenderFrame frame = { 1, options.width / 2.0, options.height / 2.0 };
+	if (!bounds.valid)
+		return frame;
+
+	double width = bounds.xMax - bounds.xMin;
+	double height = bounds.yMax - bounds.yMin;
+	if (width > 0 && height > 0)
+		frame.scale = std::min(available_width / width, available_height / height);
+	else if (width > 0)
+		frame.scale = available_width / width;
+	else if (height > 0)
+		frame.scale = available_height / height;
+
+	frame.offsetX = options.width / 2.0 - (bounds.xMin + bounds.xMax) / 2 * frame.scale;
+	frame.offsetY = options.height / 2.0 - (bounds.yMin + bounds.yMax) / 2 * frame.scale;
+	return frame;
+}
+
+std::string escapeXml(const std::string & text)
+{
+	std::string result;
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '&': result += "&amp;"; break;
+		case '<': result += "&lt;"; break;
+		case '>': result += "&gt;"; break;
+		case '"': result += "&quot;"; break;
+		default: result += c;
+		}
+	}
+	return result;
+}
+
+// an 8 bit grayscale image, white background
+class Canvas
+{
+public:
+	Canvas(int width, int height) : m_width(width), m_height(height), m_pixels(std::size_t(width) * height, 255) {}
+
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	const unsigned char * row(int y) const { return &m_pixels[std::size_t(y) * m_width]; }
+
+	void set(int x, int y)
+	{
+		if (x >= 0 && y >= 0 && x < m_width && y < m_height)
+			m_pixels[std::size_t(y) * m_width + x] = 0;
+	}
+
+	void fillDisc(double cx, double cy, double radius)
+	{
+		radius = std::max(radius, 0.5);
+		int x0 = int(std::floor(cx - radius)), x1 = int(std::ceil(cx + radius));
+		int y0 = int(std::floor(cy - radius)), y1 = int(std::ceil(cy + radius));
+		for (int y = std::max(y0, 0); y <= std::min(y1, m_height - 1); y++)
+			for (int x = std::max(x0, 0); x <= std::min(x1, m_width - 1); x++)
+			{
+				double dx = x + 0.5 - cx, dy = y + 0.5 - cy;
+				if (dx * dx + dy * dy <= radius * radius)
+					set(x, y);
+			}
+	}
+
+	// Bresenham line, stamping a square of the pen width at every step
+	void drawLine(double fx0, double fy0, double fx1, double fy1, int pen)
+	{
+		int x0 = int(std::floor(fx0)), y0 = int(std::floor(fy0));
+		int x1 = int(std::floor(fx1)), y1 = int(std::floor(fy1));
+		int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+		int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+		int error = dx + dy;
+		int low = -(pen - 1) / 2, high = pen / 2;
+
+		while (true)
+		{
+			for (int oy = low; oy <= high; oy++)
+				for (int ox = low; ox <= high; ox++)
+					set(x0 + ox, y0 + oy);
+			if (x0 == x1 && y0 == y1)
+				break;
+			int twice = 2 * error;
+			if (twice >= dy) { error += dy; x0 += sx; }
+			if (twice <= dx) { error += dx; y0 += sy; }
+		}
+	}
+
+	// text centered on (cx,cy), em is the pixel height of a glyph cell
+	void drawText(double cx, double cy, double rotation, double em, const std::string & text)
+	{
+		if (text.empty())
+			return;
+
+		double cell = std::max(1.0, em / 8);
+		double halfWidth = (text.size() * 6 - 1) * cell / 2;
+		double halfHeight = 7 * cell / 2;
+		double reach = std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight) + 1;
+		double cosine = std::cos(rotation), sine = std::sin(rotation);
+
+		for (int y = std::max(int(cy - reach), 0); y <= std::min(int(cy + reach), m_height - 1); y++)
+			for (int x = std::max(int(cx - reach), 0); x <= std::min(int(cx + reach), m_width - 1); x++)
+			{
+				double dx = x + 0.5 - cx, dy = y + 0.5 - cy;
+				double u = (dx * cosine + dy * sine + halfWidth) / cell;
+				double v = (-dx * sine + dy * cosine + halfHeight) / cell;
+				if (u < 0 || v < 0)
+					continue;
+				std::size_t column = std::size_t(u), glyph = column / 6, row = std::size_t(v);
+				if (glyph >= text.size() || column % 6 == 5 || row >= 7)
+					continue;
+				unsigned char c = static_cast<unsigned char>(text[glyph]);
+				if (c < 32 || c > 126)
+					c = '?';
+				if (GLYPHS[c - 32][column % 6] & (1 << row))
+					set(x, y);
+			}
+	}
+
+private:
+	int m_width;
+	int m_height;
+	std::vector<unsigned char> m_pixels;
+};
+
+void drawMessages(const DrawBuffer & buffer, std::size_t first, Canvas & canvas, const RenderOptions & options)
+{
+	double line = options.margin + MESSAGE_EM / 2;
+	for (std::size_t i = first; i < buffer.size(); i++)
+	{
+		const DrawCommand & command = buffer[i];
+		if (command.kind != DrawCommand::OutputKind && command.kind != DrawCommand::ErrorKind)
+			continue;
+		const std::string & text = buffer.textOf(command);
+		double halfWidth = (text.size() * 6 - 1) * (MESSAGE_EM / 8) / 2;
+		canvas.drawText(options.margin + halfWidth, line, 0, MESSAGE_EM, text);
+		line += MESSAGE_EM * 1.25;
+	}
+}
+
+/*********************************** PNG encoding ************************************/
+
+std::vector<uint32_t> makeCrcTable()
+{
+	std::vector<uint32_t> table(256);
+	for (uint32_t n = 0; n < 256; n++)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+	return table;
+}
+
+uint32_t crc32Update(uint32_t crc, const unsigned char * data, std::size_t size)
+{
+	static const std::vector<uint32_t> table = makeCrcTable();
+	for (std::size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+void putBigEndian(std::vector<unsigned char> & out, uint32_t value)
+{
+	out.push_back((value >> 24) & 0xFF);
+	out.push_back((value >> 16) & 0xFF);
+	out.push_back((value >> 8) & 0xFF);
+	out.push_back(value & 0xFF);
+}
+
+void writeChunk(std::ostream & out, const char * type, const std::vector<unsigned char> & data)
+{
+	std::vector<unsigned char> chunk;
+	putBigEndian(chunk, uint32_t(data.size()));
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	uint32_t crc = crc32Update(0xFFFFFFFFu, &chunk[4], chunk.size() - 4) ^ 0xFFFFFFFFu;
+	putBigEndian(chunk, crc);
+	out.write(reinterpret_cast<const char *>(chunk.data()), chunk.size());
+}
+
+// least significant bit first, as deflate requires
+class BitWriter
+{
+public:
+	explicit BitWriter(std::vector<unsigned char> & out) : m_out(out) {}
+
+	void bits(uint32_t value, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			m_current |= ((value >> i) & 1) << m_used;
+			if (++m_used == 8)
+				flush();
+		}
+	}
+
+	// huffman codes are stored most significant bit first
+	void code(uint32_t value, int count)
+	{
+		for (int i = count - 1; i >= 0; i--)
+			bits((value >> i) & 1, 1);
+	}
+
+	void flush()
+	{
+		if (m_used > 0)
+			m_out.push_back(m_current);
+		m_current = 0;
+		m_used = 0;
+	}
+
+private:
+	std::vector<unsigned char> & m_out;
+	unsigned m_current = 0;
+	int m_used = 0;
+};
+
+void deflateLiteral(BitWriter & writer, unsigned value)
+{
+	if (value < 144) writer.code(0x30 + value, 8);
+	else if (value < 256) writer.code(0x190 + value - 144, 9);
+	else if (value < 280) writer.code(value - 256, 7);
+	else writer.code(0xC0 + value - 280, 8);
+}
+
+void deflateMatch(BitWriter & writer, unsigned length, unsigned distance)
+{
+	static const unsigned length_base[29] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258 };
+	static const unsigned length_extra[29] = { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+	static const unsigned distance_base[30] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577 };
+	static const unsigned distance_extra[30] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+	int code = 28;
+	while (length_base[code] > length) code--;
+	deflateLiteral(writer, 257 + code);
+	writer.bits(length - length_base[code], length_extra[code]);
+
+	code = 29;
+	while (distance_base[code] > distance) code--;
+	writer.code(code, 5);
+	writer.bits(distance - distance_base[code], distance_extra[code]);
+}
+
+// zlib stream with fixed huffman codes, matching runs and the row above
+std::vector<unsigned char> zlibCompress(const std::vector<unsigned char> & data, std::size_t stride)
+{
+	std::vector<unsigned char> out = { 0x78, 0x01 };
+	BitWriter writer(out);
+	writer.bits(1, 1); // final block
+	writer.bits(1, 2); // fixed huffman codes
+
+	std::size_t i = 0;
+	while (i < data.size())
+	{
+		std::size_t limit = std::min<std::size_t>(258, data.size() - i);
+		std::size_t run = 0;
+		if (i > 0)
+			while (run < limit && data[i + run] == data[i - 1]) run++;
+		std::size_t above = 0;
+		if (i >= stride && stride <= 32768)
+			while (above < limit && data[i + above] == data[i - stride + above]) above++;
+
+		if (run >= 3 && run >= above)
+		{
+			deflateMatch(writer, unsigned(run), 1);
+			i += run;
+		}
+		else if (above >= 3)
+		{
+			deflateMatch(writer, unsigned(above), unsigned(stride));
+			i += above;
+		}
+		else
+		{
+			deflateLiteral(writer, data[i]);
+			i++;
+		}
+	}
+	deflateLiteral(writer, 256);
+	writer.flush();
+
+	uint32_t a = 1, b = 0;
+	for (unsigned char c : data)
+	{
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(out, (b << 16) | a);
+	return out;
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+void renderSvg(const DrawBuffer & buffer, std::ostream & out, const RenderOptions & options)
+{
+	std::size_t first = firstRenderedCommand(buffer);
+	RenderFrame frame = fitFrame(buffer, first, options);
+	const double degrees = 180 / std::atan2(0, -1);
+
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		<< "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << options.width << "\" height=\"" << options.height
+		<< "\" viewBox=\"0 0 " << options.width << " " << options.height << "\">\n"
+		<< "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+
+	double line = options.margin + MESSAGE_EM;
+	for (std::size_t i = first; i < buffer.size(); i++)
+	{
+		const DrawCommand & command = buffer[i];
+		switch (command.kind)
+		{
+		case DrawCommand::PointKind:
+			out << "<circle cx=\"" << frame.x(command.x1) << "\" cy=\"" << frame.y(command.y1)
+				<< "\" r=\"" << std::max(command.size * frame.scale / 2, 0.5) << "\" fill=\"black\"/>\n";
+			break;
+		case DrawCommand::LineKind:
+			out << "<line x1=\"" << frame.x(command.x1) << "\" y1=\"" << frame.y(command.y1)
+				<< "\" x2=\"" << frame.x(command.x2) << "\" y2=\"" << frame.y(command.y2)
+				<< "\" stroke=\"black\" stroke-width=\"" << std::max(command.size * frame.scale, 1.0) << "\"/>\n";
+			break;
+		case DrawCommand::TextKind:
+		{
+			double x = frame.x(command.x1), y = frame.y(command.y1);
+			out << "<text x=\"" << x << "\" y=\"" << y << "\" font-family=\"monospace\" font-size=\""
+				<< TEXT_EM * command.size * frame.scale << "\" text-anchor=\"middle\" dominant-baseline=\"central\"";
+			if (command.rotation != 0)
+				out << " transform=\"rotate(" << command.rotation * degrees << " " << x << " " << y << ")\"";
+			out << ">" << escapeXml(buffer.textOf(command)) << "</text>\n";
+			break;
+		}
+		case DrawCommand::OutputKind:
+		case DrawCommand::ErrorKind:
+			out << "<text x=\"" << options.margin << "\" y=\"" << line << "\" font-family=\"monospace\" font-size=\""
+				<< MESSAGE_EM << "\">" << escapeXml(buffer.textOf(command)) << "</text>\n";
+			line += MESSAGE_EM * 1.25;
+			break;
+		}
+	}
+
+	out << "</svg>\n";
+}
+
+void renderPng(const DrawBuffer & buffer, std::ostream & out, const RenderOptions & options)
+{
+	std::size_t first = firstRenderedCommand(buffer);
+	RenderFrame frame = fitFrame(buffer, first, options);
+	Canvas canvas(std::max(1, options.width), std::max(1, options.height));
+
+	for (std::size_t i = first; i < buffer.size(); i++)
+	{
+		const DrawCommand & command = buffer[i];
+		switch (command.kind)
+		{
+		case DrawCommand::PointKind:
+			canvas.fillDisc(frame.x(command.x1), frame.y(command.y1), command.size * frame.scale / 2);
+			break;
+		case DrawCommand::LineKind:
+			canvas.drawLine(frame.x(command.x1), frame.y(command.y1), frame.x(command.x2), frame.y(command.y2),
+				std::max(1, int(std::lround(command.size * frame.scale))));
+			break;
+		case DrawCommand::TextKind:
+			canvas.drawText(frame.x(command.x1), frame.y(command.y1), command.rotation,
+				TEXT_EM * command.size * frame.scale, buffer.textOf(command));
+			break;
+		case DrawCommand::OutputKind:
+		case DrawCommand::ErrorKind:
+			break;
+		}
+	}
+	drawMessages(buffer, first, canvas, options);
+
+	// every row starts with filter type 0 (none)
+	std::size_t stride = std::size_t(canvas.width()) + 1;
+	std::vector<unsigned char> raw;
+	raw.reserve(stride * canvas.height());
+	for (int y = 0; y < canvas.height(); y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), canvas.row(y), canvas.row(y) + canvas.width());
+	}
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, uint32_t(canvas.width()));
+	putBigEndian(header, uint32_t(canvas.height()));
+	header.push_back(8); // bit depth
+	header.push_back(0); // grayscale
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // no interlace
+
+	static const char signature[8] = { char(0x89), 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	out.write(signature, 8);
+	writeChunk(out, "IHDR", header);
+	writeChunk(out, "IDAT", zlibCompress(raw, stride));
+	writeChunk(out, "IEND", std::vector<unsigned char>());
+}
+
+bool renderToFile(const DrawBuffer & buffer, const std::string & filename, const RenderOptions & options)
+{
+	std::string extension;
+	std::size_t dot = filename.find_last_of('.');
+	if (dot != std::string::npos)
+		extension = filename.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension != "svg" && extension != "png")
+		return false;
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out)
+		return false;
+
+	if (extension == "svg")
+		renderSvg(buffer, out, options);
+	else
+		renderPng(buffer, out, options);
+
+	return bool(out);
+}
@@ -0,0 +1,42 @@
+/*! \file plot_renderer.hpp
+Defines the headless renderer writing DrawBuffers to SVG and PNG files.
+
+The renderer uses the same conventions as the notebook output widget:
+coordinates are scene units, points are centered discs of diameter size,
+lines have a pen width of thickness (0 is a one pixel line), texts are
+centered on their position and rotated about their center, and the whole
+plot is scaled uniformly to fit the image. It needs no display server.
+ */
+#ifndef PLOT_RENDERER_HPP
+#define PLOT_RENDERER_HPP
+
+#include <ostream>
+#include <string>
+
+#include "draw_buffer.hpp"
+
+/*! \struct RenderOptions
+\brief Size of the rendered image in pixels.
+ */
+struct RenderOptions
+{
+	int width = 800;
+	int height = 600;
+	int margin = 20;
+};
+
+/// render buffer as an SVG document
+void renderSvg(const DrawBuffer & buffer, std::ostream & out, const RenderOptions & options);
+
+/// render buffer as a grayscale PNG image
+void renderPng(const DrawBuffer & buffer, std::ostream & out, const RenderOptions & options);
+
+/*! Render buffer to a file, the format is chosen by the extension.
+\param buffer the commands to render
+\param filename a path ending in .svg or .png
+\param options the image size
+\return false if the extension is unknown or the file cannot be written
+ */
+bool renderToFile(const DrawBuffer & buffer, const std::string & filename, const RenderOptions & options);
+
+#endif
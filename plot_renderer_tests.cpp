@@ -0,0 +1,86 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "plot_renderer.hpp"
+
+std::size_t countOccurrences(const std::string & text, const std::string & pattern)
+{
+	std::size_t count = 0;
+	for (std::size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1))
+		count++;
+	return count;
+}
+
+TEST_CASE("Test svg rendering of primitives", "[plot_renderer]")
+{
+	DrawBuffer buffer;
+	buffer.addPoint(0, 0, 1);
+	buffer.addPoint(10, 10, 1);
+	buffer.addLine(0, 0, 10, 10, 0);
+	buffer.addText(5, 12, -1.5707963267948966, 1, "a < b");
+
+	std::ostringstream out;
+	renderSvg(buffer, out, RenderOptions());
+	std::string svg = out.str();
+
+	REQUIRE(svg.find("<svg") != std::string::npos);
+	REQUIRE(svg.find("width=\"800\" height=\"600\"") != std::string::npos);
+	REQUIRE(countOccurrences(svg, "<circle") == 2);
+	REQUIRE(countOccurrences(svg, "<line") == 1);
+	REQUIRE(countOccurrences(svg, "<text") == 1);
+	REQUIRE(svg.find("a &lt; b") != std::string::npos);
+	REQUIRE(svg.find("rotate(-90 ") != std::string::npos);
+}
+
+TEST_CASE("Test rendering starts at the last error", "[plot_renderer]")
+{
+	DrawBuffer buffer;
+	buffer.addPoint(0, 0, 1);
+	buffer.addError("size not a positive number");
+	buffer.addOutput("(1)");
+
+	std::ostringstream out;
+	renderSvg(buffer, out, RenderOptions());
+	std::string svg = out.str();
+
+	REQUIRE(countOccurrences(svg, "<circle") == 0);
+	REQUIRE(svg.find("size not a positive number") != std::string::npos);
+	REQUIRE(svg.find("(1)") != std::string::npos);
+}
+
+TEST_CASE("Test png rendering header", "[plot_renderer]")
+{
+	DrawBuffer buffer;
+	buffer.addLine(-1, -1, 1, 1, 0.1);
+	buffer.addText(0, 0, 0, 1, "plot");
+
+	RenderOptions options;
+	options.width = 320;
+	options.height = 200;
+
+	std::ostringstream out;
+	renderPng(buffer, out, options);
+	std::string png = out.str();
+
+	REQUIRE(png.size() > 33);
+	REQUIRE(png.substr(1, 3) == "PNG");
+	REQUIRE(png.substr(12, 4) == "IHDR");
+
+	auto read32 = [&png](std::size_t at) {
+		return (unsigned(static_cast<unsigned char>(png[at])) << 24) | (unsigned(static_cast<unsigned char>(png[at + 1])) << 16)
+			| (unsigned(static_cast<unsigned char>(png[at + 2])) << 8) | unsigned(static_cast<unsigned char>(png[at + 3]));
+	};
+	REQUIRE(read32(16) == 320);
+	REQUIRE(read32(20) == 200);
+	REQUIRE(png.substr(png.size() - 8, 4) == "IEND");
+}
+
+TEST_CASE("Test render to file rejects unknown formats", "[plot_renderer]")
+{
+	DrawBuffer buffer;
+	buffer.addPoint(0, 0, 1);
+
+	REQUIRE_FALSE(renderToFile(buffer, "plot.bmp", RenderOptions()));
+	REQUIRE_FALSE(renderToFile(buffer, "plot", RenderOptions()));
+}
@@ -0,0 +1,59 @@
+#include "plot_stream.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// primitives added between two readings of the clock
+const std::size_t CLOCK_STRIDE = 64;
+
+thread_local PlotStream * activeStream = nullptr;
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+PlotStream::PlotStream(Consumer consumer)
+	: m_consumer(consumer), m_previous(activeStream), m_lastFlush(Clock::now())
+{
+	activeStream = this;
+}
+
+PlotStream::~PlotStream()
+{
+	activeStream = m_previous;
+}
+
+PlotStream * PlotStream::current() noexcept
+{
+	return activeStream;
+}
+
+void PlotStream::add(const Expression & primitive)
+{
+	buildDrawBuffer(primitive, m_pending);
+
+	std::size_t size = m_pending.size();
+	if (size >= PLOT_STREAM_CHUNK || (size % CLOCK_STRIDE == 0 && Clock::now() - m_lastFlush >= PLOT_STREAM_INTERVAL))
+		flush();
+}
+
+void PlotStream::flush()
+{
+	if (!m_pending.empty())
+		m_consumer(m_pending);
+
+	m_pending.clear();
+	m_lastFlush = Clock::now();
+}
+
+void streamPrimitives(const Expression & plot, std::size_t first)
+{
+	PlotStream * stream = PlotStream::current();
+	if (stream == nullptr)
+		return;
+
+	const std::size_t size = static_cast<std::size_t>(plot.tailSize());
+	for (std::size_t k = first; k < size; k++)
+		stream->add(plot.tailAt(k));
+}
@@ -0,0 +1,65 @@
+/*! \file plot_stream.hpp
+Defines the streaming of plot primitives while a plot is being built.
+
+discrete-plot and continuous-plot hand the primitives they make to the
+PlotStream of their thread, if there is one. The stream translates them into
+draw commands and passes them on in chunks, so the notebook can show a large
+plot while it is still being computed. Without a stream, a plot pays one
+thread_local load per batch of primitives.
+ */
+#ifndef PLOT_STREAM_HPP
+#define PLOT_STREAM_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+#include "draw_buffer.hpp"
+#include "expression.hpp"
+
+/// commands passed on together at most, and the longest a command waits
+const std::size_t PLOT_STREAM_CHUNK = 4096;
+const std::chrono::milliseconds PLOT_STREAM_INTERVAL(30);
+
+/*! \class PlotStream
+\brief Receiver of the primitives of the plots built on one thread.
+
+A stream is active on the thread that created it until it is destroyed, and
+restores the stream that was active before. The consumer is called on that
+thread.
+ */
+class PlotStream
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	typedef std::function<void(const DrawBuffer & chunk)> Consumer;
+
+	/// become the stream of the calling thread
+	explicit PlotStream(Consumer consumer);
+
+	/// stop streaming, commands still pending are dropped
+	~PlotStream();
+
+	PlotStream(const PlotStream &) = delete;
+	PlotStream & operator=(const PlotStream &) = delete;
+
+	/// the stream of the calling thread, nullptr if there is none
+	static PlotStream * current() noexcept;
+
+	/// translate a point, line or text, passing the pending commands on when due
+	void add(const Expression & primitive);
+
+	/// pass the pending commands on
+	void flush();
+
+private:
+	Consumer m_consumer;
+	DrawBuffer m_pending;
+	PlotStream * m_previous;
+	Clock::time_point m_lastFlush;
+};
+
+/// hand the elements of plot from index first on to the stream of this thread, if any
+void streamPrimitives(const Expression & plot, std::size_t first);
+
+#endif
@@ -0,0 +1,79 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include "draw_buffer.hpp"
+#include "interpreter.hpp"
+#include "plot_stream.hpp"
+#include "test_helpers.hpp"
+
+const std::string BIG_PLOT = "(begin (define f (lambda (x) (list x (* x x)))) "
+                             "(discrete-plot (map f (range 0 4999 1)) (list (list \"title\" \"T\"))))";
+
+TEST_CASE("Test plots are streamed in chunks", "[plot_stream]")
+{
+	REQUIRE(PlotStream::current() == nullptr);
+
+	std::vector<std::size_t> sizes;
+	DrawBuffer streamed;
+	Expression plot;
+	{
+		PlotStream stream([&](const DrawBuffer & chunk) {
+			sizes.push_back(chunk.size());
+			streamed.append(chunk);
+		});
+		REQUIRE(PlotStream::current() == &stream);
+
+		plot = evaluateProgram(BIG_PLOT);
+		stream.flush();
+	}
+	REQUIRE(PlotStream::current() == nullptr);
+
+	// every primitive of the plot, in order
+	DrawBuffer whole;
+	buildDrawBuffer(plot, whole);
+	REQUIRE(streamed.size() == whole.size());
+	for (std::size_t k = 0; k < whole.size(); k++)
+	{
+		REQUIRE(streamed[k].kind == whole[k].kind);
+		REQUIRE(streamed[k].x1 == whole[k].x1);
+		REQUIRE(streamed[k].y1 == whole[k].y1);
+	}
+
+	REQUIRE(sizes.size() > 1);
+	for (std::size_t size : sizes)
+		REQUIRE(size <= PLOT_STREAM_CHUNK);
+
+	// continuous plots are streamed once sampled
+	std::size_t lines = 0;
+	{
+		PlotStream stream([&](const DrawBuffer & chunk) { lines += chunk.size(); });
+		plot = evaluateProgram("(begin (define g (lambda (x) (* x x))) (continuous-plot g (list -1 1)))");
+		stream.flush();
+	}
+	whole.clear();
+	buildDrawBuffer(plot, whole);
+	REQUIRE(lines == whole.size());
+}
+
+TEST_CASE("Test plot streams nest", "[plot_stream]")
+{
+	std::size_t outer = 0, inner = 0;
+	PlotStream first([&](const DrawBuffer & chunk) { outer += chunk.size(); });
+	{
+		PlotStream second([&](const DrawBuffer & chunk) { inner += chunk.size(); });
+		evaluateProgram("(discrete-plot (list (list 0 0) (list 1 1)) (list))");
+		second.flush();
+	}
+	REQUIRE(PlotStream::current() == &first);
+	first.flush();
+	REQUIRE(inner > 0);
+	REQUIRE(outer == 0);
+
+	// pending commands of a stream destroyed early are dropped
+	{
+		PlotStream dropped([&](const DrawBuffer & chunk) { outer += chunk.size(); });
+		evaluateProgram("(discrete-plot (list (list 0 0) (list 1 1)) (list))");
+	}
+	REQUIRE(outer == 0);
+}
@@ -3,11 +3,21 @@
 #include <iostream>
 #include <fstream>
 #include <thread>
+#include <vector>
 #include "startup_config.hpp"
 #include "interpreter.hpp"
 #include "semantic_error.hpp"
 #include "cntlc_tracer.hpp"
-typedef message_queue<std::string> MessageQueueStr;
+#include "draw_buffer.hpp"
+#include "plot_renderer.hpp"
+#include "batch_runner.hpp"
+#include "startup_snapshot.hpp"
+#include "result_writer.hpp"
+#include "spsc_queue.hpp"
+
+// the REPL thread is the only producer of the input channel and the kernel
+// thread the only consumer, the other way around for the output channel
+typedef SpscQueue<std::string> KernelChannel;
 
 void repl(Interpreter interp);
 void prompt() {
@@ -40,7 +50,8 @@ int eval_from_stream(std::istream & stream, std::string filename) {
 	else {
 		try {
 			Expression exp = interp.evaluate();
-			std::cout << exp << std::endl;
+			ResultWriter().write(exp, std::cout);
+			std::cout << std::endl;
 		}
 		catch (const SemanticError & ex) {
 			std::cerr << ex.what() << std::endl;
@@ -73,15 +84,132 @@ int eval_from_command(std::string argexp) {
 	return eval_from_stream(expression, "no_file");
 }
 
-void ProcessData(MessageQueueStr * msgIn, MessageQueueStr * msgOut, Interpreter * interp)
+bool load_startup(Interpreter & interp) {
+
+	try {
+		interp = Interpreter(startupEnvironmentFromFile(STARTUP_FILE));
+	}
+	catch (const SemanticError & ex) {
+		std::cerr << ex.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// evaluate like the notebook does and write the graphical result to outfile
+int render_from_stream(std::istream & stream, const std::string & outfile, const RenderOptions & options) {
+
+	Interpreter interp;
+
+	if (!load_startup(interp))
+		return EXIT_FAILURE;
+
+	if (!interp.parseStream(stream)) {
+		error("Invalid Program. Could not parse.");
+		return EXIT_FAILURE;
+	}
+
+	DrawBuffer commands;
+	try {
+		buildDrawBuffer(interp.evaluate(), commands);
+	}
+	catch (const SemanticError & ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (!renderToFile(commands, outfile, options)) {
+		error("Could not write " + outfile + ", expected a .png or .svg file.");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+bool parse_size(const std::string & size, RenderOptions & options) {
+
+	std::istringstream iss(size);
+	int width = 0, height = 0;
+	char separator = 0;
+
+	if (!(iss >> width >> separator >> height) || separator != 'x' || width <= 0 || height <= 0)
+		return false;
+
+	options.width = width;
+	options.height = height;
+	return true;
+}
+
+// plotscript --batch [-j N] [-f png|svg] [-d DIR] [-s WxH] (script.pls | @manifest)...
+int run_batch(const std::vector<std::string> & args, const RenderOptions & render) {
+
+	BatchOptions options;
+	options.render = render;
+	std::vector<std::string> scripts;
+
+	for (std::size_t i = 1; i < args.size(); i++) {
+		if (args[i] == "-j" && i + 1 < args.size()) {
+			std::istringstream jobs(args[++i]);
+			if (!(jobs >> options.jobs)) {
+				error("Invalid number of jobs.");
+				return EXIT_FAILURE;
+			}
+		}
+		else if (args[i] == "-f" && i + 1 < args.size()) {
+			options.imageFormat = args[++i];
+			if (options.imageFormat != "png" && options.imageFormat != "svg") {
+				error("Invalid image format, expected png or svg.");
+				return EXIT_FAILURE;
+			}
+		}
+		else if (args[i] == "-d" && i + 1 < args.size()) {
+			options.outputDir = args[++i];
+		}
+		else if (args[i][0] == '@') {
+			std::ifstream manifest(args[i].substr(1));
+			if (!manifest) {
+				error("Could not open manifest " + args[i].substr(1) + ".");
+				return EXIT_FAILURE;
+			}
+			std::vector<std::string> listed = readManifest(manifest);
+			scripts.insert(scripts.end(), listed.begin(), listed.end());
+		}
+		else {
+			scripts.push_back(args[i]);
+		}
+	}
+
+	std::ifstream startup(STARTUP_FILE);
+	if (!startup) {
+		error("Could not load " + STARTUP_FILE + ".");
+		return EXIT_FAILURE;
+	}
+	std::ostringstream prelude;
+	prelude << startup.rdbuf();
+	options.prelude = prelude.str();
+
+	std::size_t succeeded = 0;
+	for (auto & result : runBatch(scripts, options)) {
+		if (result.ok)
+			succeeded++;
+		else
+			std::cerr << result.script << ": " << result.message << std::endl;
+	}
+	info(std::to_string(succeeded) + " of " + std::to_string(scripts.size()) + " scripts succeeded.");
+
+	return (succeeded == scripts.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void ProcessData(KernelChannel * msgIn, KernelChannel * msgOut, Interpreter * interp)
 {
+	// keeps its buffer from one result to the next
+	ResultWriter writer;
 	while (1)
 	{
 		std::string popMessage;
-		msgIn->wait_and_pop(popMessage);
+		msgIn->pop(popMessage);
 		if (popMessage == "%stop") break;
 		std::istringstream expMsg(popMessage);
-		std::ostringstream textOutput;
 		if (!interp->parseStream(expMsg))
 		{
 			msgOut->push("Invalid Expression. Could not parse.");
@@ -91,13 +219,11 @@ void ProcessData(MessageQueueStr * msgIn, MessageQueueStr * msgOut, Interpreter
 			try
 			{
 				Expression exp = interp->evaluate();
-				textOutput << exp;
-				msgOut->push(textOutput.str());
+				msgOut->push(writer.format(exp));
 			}
 			catch (const SemanticError & ex)
 			{
-				textOutput << ex.what();
-				msgOut->push(textOutput.str());
+				msgOut->push(ex.what());
 			}
 		}
 	}
@@ -111,8 +237,8 @@ void repl(Interpreter interp) {
 	{
 		global_status_flag = 0;
 		Interpreter InscopeInterp(interp);
-		MessageQueueStr * msgIn = new MessageQueueStr();
-		MessageQueueStr * msgOut = new MessageQueueStr();
+		KernelChannel * msgIn = new KernelChannel();
+		KernelChannel * msgOut = new KernelChannel();
 		bool KernalRunning = true;
 		std::thread * worker;
 		worker = new std::thread(ProcessData, msgIn, msgOut, &InscopeInterp);
@@ -160,7 +286,7 @@ void repl(Interpreter interp) {
 			else
 			{
 				msgIn->push(line);
-				while (!msgOut->try_pop(textOutput))
+				while (!msgOut->tryPop(textOutput))
 				{
 					if (global_status_flag > 0) {
 						global_status_flag = 0;
@@ -168,13 +294,13 @@ void repl(Interpreter interp) {
 						msgIn->push("%stop");
 						worker->detach();
 						worker->~thread();
-						msgIn = new MessageQueueStr();
-						msgOut = new MessageQueueStr();
+						msgIn = new KernelChannel();
+						msgOut = new KernelChannel();
 						InscopeInterp = interp;
 						worker = new std::thread(ProcessData, msgIn, msgOut, &InscopeInterp);
 						break;
 					}
-					if (msgOut->try_pop(textOutput))
+					if (msgOut->tryPop(textOutput))
 						break;
 				}
 				std::cout << textOutput;
@@ -185,6 +311,50 @@ void repl(Interpreter interp) {
 
 int main(int argc, char *argv[])
 {
+	std::string outfile;
+	RenderOptions options;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-o" && i + 1 < argc) {
+			outfile = argv[++i];
+		}
+		else if (arg == "-s" && i + 1 < argc) {
+			if (!parse_size(argv[++i], options)) {
+				error("Invalid image size, expected WIDTHxHEIGHT.");
+				return EXIT_FAILURE;
+			}
+		}
+		else {
+			args.push_back(arg);
+		}
+	}
+
+	if (!args.empty() && args[0] == "--batch") {
+		if (!outfile.empty()) {
+			error("Use -f to render the results of a batch.");
+			return EXIT_FAILURE;
+		}
+		return run_batch(args, options);
+	}
+
+	if (!outfile.empty()) {
+		if (args.size() == 1) {
+			std::ifstream ifs(args[0]);
+			if (!ifs) {
+				error("Could not open file for reading.");
+				return EXIT_FAILURE;
+			}
+			return render_from_stream(ifs, outfile, options);
+		}
+		else if (args.size() == 2 && args[0] == "-e") {
+			std::istringstream expression(args[1]);
+			return render_from_stream(expression, outfile, options);
+		}
+		error("Incorrect number of command line arguments.");
+		return EXIT_FAILURE;
+	}
+
 	if (argc == 2) {
 		return eval_from_file(argv[1]);
 	}
@@ -0,0 +1,65 @@
+// Compares the mutex based message_queue with the lock-free SpscQueue
+// passing strings from one thread to another, as the REPL channels do.
+//
+// usage: queue_benchmark [messages] [message length]
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "message_queue.h"
+#include "spsc_queue.hpp"
+
+template <typename Push, typename Pop>
+double measure(long messages, const std::string & message, Push push, Pop pop)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&]() {
+		for (long i = 0; i < messages; i++)
+			push(message);
+	});
+
+	std::string received;
+	for (long i = 0; i < messages; i++)
+		pop(received);
+	producer.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+void report(const std::string & name, long messages, double seconds)
+{
+	std::cout << name << ": " << seconds * 1e3 << " ms, "
+		<< messages / seconds / 1e6 << " million messages per second" << std::endl;
+}
+
+int main(int argc, char * argv[])
+{
+	long messages = 2000000;
+	std::size_t length = 64;
+	if (argc > 1)
+		std::istringstream(argv[1]) >> messages;
+	if (argc > 2)
+		std::istringstream(argv[2]) >> length;
+
+	std::string message(length, 'x');
+	std::cout << messages << " messages of " << length << " bytes" << std::endl;
+
+	message_queue<std::string> locked;
+	double lockedSeconds = measure(messages, message,
+		[&](const std::string & m) { locked.push(m); },
+		[&](std::string & m) { locked.wait_and_pop(m); });
+	report("message_queue", messages, lockedSeconds);
+
+	SpscQueue<std::string> ring(1024);
+	double ringSeconds = measure(messages, message,
+		[&](const std::string & m) { ring.push(m); },
+		[&](std::string & m) { ring.pop(m); });
+	report("SpscQueue    ", messages, ringSeconds);
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+#include "result_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#define RESULT_CACHE_POSIX
+#endif
+
+#include "semantic_error.hpp"
+#include "serialization.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// procedures reading or writing files
+bool isFileAccess(const std::string & name)
+{
+	static const std::set<std::string> names = { "read-csv", "read-binary", "load", "save" };
+	return names.count(name) > 0;
+}
+
+// procedures and special forms whose effect a cached result would skip
+bool isImpure(const std::string & name)
+{
+	return name == "define" || isFileAccess(name);
+}
+
+// 64 bit FNV-1a
+std::uint64_t hashBytes(const std::string & bytes, std::uint64_t hash = 14695981039346656037ull)
+{
+	for (unsigned char c : bytes)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// collect the user definitions exp refers to, following the bodies of
+// procedures, false if a name for which impure is true is reached
+bool collectDependencies(const Expression & exp, const Environment & env, std::map<std::string, std::uint64_t> & dependencies,
+	bool (*impure)(const std::string &))
+{
+	const Atom & head = exp.head();
+	if (head.isSymbol())
+	{
+		const std::string & name = head.asSymbol();
+		if (impure(name))
+			return false;
+
+		if (dependencies.count(name) == 0)
+		{
+			if (env.is_userDefine(head))
+			{
+				Expression procedure = env.get_UserDefineProc(head);
+				dependencies[name] = procedure.hash();
+				if (!collectDependencies(procedure, env, dependencies, impure))
+					return false;
+			}
+			else if (env.is_exp(head))
+			{
+				dependencies[name] = env.get_exp(head).hash();
+			}
+		}
+	}
+
+	for (auto child = exp.tailConstBegin(); child != exp.tailConstEnd(); ++child)
+		if (!collectDependencies(*child, env, dependencies, impure))
+			return false;
+
+	return true;
+}
+
+struct CacheEntry
+{
+	std::string path;
+	std::size_t size;
+	long long used;
+};
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+bool resultCacheKey(const Expression & program, const Environment & env, std::uint64_t & key)
+{
+	std::map<std::string, std::uint64_t> dependencies;
+	if (!collectDependencies(program, env, dependencies, isImpure))
+		return false;
+
+	std::ostringstream material;
+	material << program.hash();
+	for (auto & dependency : dependencies)
+		material << ' ' << dependency.first << '=' << dependency.second;
+
+	key = hashBytes(material.str());
+	return true;
+}
+
+bool accessesFiles(const Expression & program, const Environment & env)
+{
+	std::map<std::string, std::uint64_t> dependencies;
+	return !collectDependencies(program, env, dependencies, isFileAccess);
+}
+
+ResultCache::ResultCache(const std::string & directory, std::size_t maxBytes, double minMilliseconds)
+	: m_directory(directory), m_maxBytes(maxBytes), m_minMilliseconds(minMilliseconds)
+{
+#ifdef RESULT_CACHE_POSIX
+	::mkdir(directory.c_str(), 0755);
+#endif
+}
+
+std::string ResultCache::pathOf(std::uint64_t key) const
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.plsb", static_cast<unsigned long long>(key));
+	return m_directory + "/" + name;
+}
+
+bool ResultCache::lookup(std::uint64_t key, Expression & result)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string path = pathOf(key);
+
+	try
+	{
+		result = loadExpression(path);
+	}
+	catch (const SemanticError &)
+	{
+		// missing, or damaged by an interrupted write of another process
+		return false;
+	}
+
+#ifdef RESULT_CACHE_POSIX
+	::utime(path.c_str(), nullptr);
+#endif
+	return true;
+}
+
+void ResultCache::store(std::uint64_t key, const Expression & result, double milliseconds)
+{
+	if (milliseconds < m_minMilliseconds)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::string path = pathOf(key);
+
+	// readers never see a partial file
+	std::string temporary = path + ".tmp";
+	if (!saveExpression(result, temporary) || std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return;
+	}
+
+	evict(path, m_maxBytes);
+}
+
+void ResultCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	evict(std::string(), 0);
+	std::remove(m_directory.c_str());
+}
+
+void ResultCache::evict(const std::string & keep, std::size_t limit)
+{
+#ifdef RESULT_CACHE_POSIX
+	DIR * directory = ::opendir(m_directory.c_str());
+	if (directory == nullptr)
+		return;
+
+	std::vector<CacheEntry> entries;
+	std::size_t total = 0;
+	while (struct dirent * item = ::readdir(directory))
+	{
+		std::string name = item->d_name;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".plsb") != 0)
+			continue;
+
+		CacheEntry entry;
+		entry.path = m_directory + "/" + name;
+		struct stat info;
+		if (::stat(entry.path.c_str(), &info) != 0)
+			continue;
+		entry.size = info.st_size;
+		entry.used = info.st_mtime;
+		total += entry.size;
+		entries.push_back(entry);
+	}
+	::closedir(directory);
+
+	std::sort(entries.begin(), entries.end(), [](const CacheEntry & a, const CacheEntry & b) { return a.used < b.used; });
+	for (auto entry = entries.begin(); entry != entries.end() && total > limit; ++entry)
+	{
+		if (entry->path == keep)
+			continue;
+		std::remove(entry->path.c_str());
+		total -= entry->size;
+	}
+#endif
+}
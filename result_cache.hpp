@@ -0,0 +1,77 @@
+/*! \file result_cache.hpp
+Defines the on-disk cache of evaluation results.
+
+A result is keyed by a hash of the program together with the values of the
+definitions it refers to, so it is found again in a later session as long as
+neither changed. Results are stored as PLSB files (see serialization.hpp)
+in one directory, and the least recently used ones are removed when the
+directory grows past its size limit.
+
+Only pure programs are cached: a program that defines symbols, reads or
+writes files, or calls a procedure that does, is always evaluated.
+ */
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "environment.hpp"
+#include "expression.hpp"
+
+/*! Compute the cache key of a program.
+\param program the parsed program
+\param env the environment it is evaluated in
+\param key receives the key
+\return false if the program is not pure and must not be cached
+ */
+bool resultCacheKey(const Expression & program, const Environment & env, std::uint64_t & key);
+
+/*! Tell if a program reads or writes files, directly or through the
+procedures it calls.
+\param program the parsed program
+\param env the environment it is evaluated in
+ */
+bool accessesFiles(const Expression & program, const Environment & env);
+
+/*! \class ResultCache
+\brief A directory of results, limited in size by least recent use.
+
+The cache may be shared by several interpreters and threads.
+ */
+class ResultCache
+{
+public:
+
+	/*! Use directory for the results, creating it if needed.
+	\param directory where results are stored
+	\param maxBytes total size of the results kept
+	\param minMilliseconds evaluations faster than this are not worth storing
+	 */
+	ResultCache(const std::string & directory, std::size_t maxBytes, double minMilliseconds = 20);
+
+	/// find the result stored under key, marking it as recently used
+	bool lookup(std::uint64_t key, Expression & result);
+
+	/// store the result of an evaluation that took milliseconds
+	void store(std::uint64_t key, const Expression & result, double milliseconds);
+
+	/// path of the file holding the result stored under key
+	std::string pathOf(std::uint64_t key) const;
+
+	/// remove every stored result and then the directory
+	void clear();
+
+private:
+	std::string m_directory;
+	std::size_t m_maxBytes;
+	double m_minMilliseconds;
+	std::mutex m_mutex;
+
+	// remove the least recently used results until the total fits in limit, never the one at keep
+	void evict(const std::string & keep, std::size_t limit);
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+#include "interpreter.hpp"
+#include "result_cache.hpp"
+#include "semantic_error.hpp"
+#include "serialization.hpp"
+#include "test_helpers.hpp"
+
+bool fileExists(const std::string & path)
+{
+	return bool(std::ifstream(path));
+}
+
+TEST_CASE("Test result cache keys", "[result_cache]")
+{
+	Interpreter interp;
+	evaluateIn(interp, "(define f (lambda (x) (* x a)))");
+	evaluateIn(interp, "(define a 2)");
+	evaluateIn(interp, "(define b 3)");
+
+	Expression program = parseProgram("(f 4)");
+	std::uint64_t key = 0, same = 0, changed = 0;
+	REQUIRE(resultCacheKey(program, interp.environment(), key));
+	REQUIRE(resultCacheKey(parseProgram("(f 4)"), interp.environment(), same));
+	REQUIRE(key == same);
+
+	// a definition used through f changes the key, an unrelated one does not
+	Interpreter other;
+	evaluateIn(other, "(define f (lambda (x) (* x a)))");
+	evaluateIn(other, "(define a 5)");
+	evaluateIn(other, "(define b 3)");
+	REQUIRE(resultCacheKey(program, other.environment(), changed));
+	REQUIRE(changed != key);
+
+	Interpreter unrelated;
+	evaluateIn(unrelated, "(define f (lambda (x) (* x a)))");
+	evaluateIn(unrelated, "(define a 2)");
+	evaluateIn(unrelated, "(define b 7)");
+	REQUIRE(resultCacheKey(program, unrelated.environment(), changed));
+	REQUIRE(changed == key);
+
+	REQUIRE(resultCacheKey(parseProgram("(f 5)"), interp.environment(), changed));
+	REQUIRE(changed != key);
+
+	// programs with effects are never cached
+	std::uint64_t ignored;
+	REQUIRE(!resultCacheKey(parseProgram("(begin (define c 1) (f c))"), interp.environment(), ignored));
+	REQUIRE(!resultCacheKey(parseProgram("(read-csv \"data.csv\")"), interp.environment(), ignored));
+	evaluateIn(interp, "(define g (lambda (name) (load name)))");
+	REQUIRE(!resultCacheKey(parseProgram("(g \"x.plsb\")"), interp.environment(), ignored));
+}
+
+TEST_CASE("Test results are reused between sessions", "[result_cache]")
+{
+	auto cache = std::make_shared<ResultCache>("result_cache_test", 1 << 20, 0);
+	std::string program = "(begin (define sq (lambda (x) (* x x))) (map sq (range 1 5 1)))";
+	std::string query = "(length (range 1 100 1))";
+
+	std::uint64_t key = 0;
+	REQUIRE(resultCacheKey(parseProgram(query), Interpreter().environment(), key));
+	std::remove(cache->pathOf(key).c_str());
+
+	Interpreter first;
+	first.setResultCache(cache);
+	evaluateIn(first, program);
+	REQUIRE(evaluateIn(first, query) == Expression(Atom(100.)));
+	REQUIRE(fileExists(cache->pathOf(key)));
+
+	// plant a different result to show the next session does not evaluate
+	REQUIRE(saveExpression(Expression(Atom(-1.)), cache->pathOf(key)));
+	Interpreter second;
+	second.setResultCache(cache);
+	REQUIRE(evaluateIn(second, query) == Expression(Atom(-1.)));
+
+	// without a cache the program is evaluated
+	Interpreter uncached;
+	REQUIRE(evaluateIn(uncached, query) == Expression(Atom(100.)));
+	std::remove(cache->pathOf(key).c_str());
+
+	// failed evaluations are not stored
+	std::string failing = "(first (list))";
+	REQUIRE(resultCacheKey(parseProgram(failing), Interpreter().environment(), key));
+	Interpreter third;
+	third.setResultCache(cache);
+	std::istringstream iss(failing);
+	REQUIRE(third.parseStream(iss));
+	REQUIRE_THROWS_AS(third.evaluate(), const SemanticError &);
+	REQUIRE(!fileExists(cache->pathOf(key)));
+
+	cache->clear();
+	REQUIRE(!fileExists("result_cache_test"));
+}
+
+TEST_CASE("Test result cache size limit", "[result_cache]")
+{
+	// each result is a list of 200 packed numbers, a bit over 1600 bytes
+	ResultCache cache("result_cache_limit_test", 4000, 0);
+	Expression value = Expression::makeSequence(0, 1, 200);
+
+	for (std::uint64_t key = 1; key <= 4; key++)
+	{
+		cache.store(key, value, 1);
+		REQUIRE(fileExists(cache.pathOf(key)));
+	}
+
+	int kept = 0;
+	for (std::uint64_t key = 1; key <= 4; key++)
+		kept += fileExists(cache.pathOf(key)) ? 1 : 0;
+	REQUIRE(kept == 2);
+
+	Expression result;
+	REQUIRE(cache.lookup(4, result));
+	REQUIRE(result == value);
+	REQUIRE(!cache.lookup(99, result));
+
+	// fast evaluations are not worth a file
+	ResultCache strict("result_cache_limit_test", 4000, 1000);
+	strict.store(5, value, 1);
+	REQUIRE(!fileExists(strict.pathOf(5)));
+
+	cache.clear();
+	REQUIRE(!fileExists("result_cache_limit_test"));
+}
@@ -0,0 +1,145 @@
+#include "result_writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// digits of value at the end of buffer, returns where they start
+char * formatInteger(unsigned long long value, char * end)
+{
+	char * begin = end;
+	do
+	{
+		*--begin = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	return begin;
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+ResultWriter::ResultWriter(int precision)
+	: m_precision(precision), m_integerLimit(std::pow(10.0, std::min(precision, 15)))
+{
+}
+
+const std::string & ResultWriter::format(const Expression & exp)
+{
+	m_buffer.clear();
+	m_out = nullptr;
+	put(exp);
+	return m_buffer;
+}
+
+void ResultWriter::write(const Expression & exp, std::ostream & out)
+{
+	m_buffer.clear();
+	m_out = &out;
+	put(exp);
+	out.write(m_buffer.data(), m_buffer.size());
+	m_buffer.clear();
+	m_out = nullptr;
+}
+
+void ResultWriter::flushIfFull()
+{
+	if (m_out != nullptr && m_buffer.size() >= RESULT_FLUSH_BYTES)
+	{
+		m_out->write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+	}
+}
+
+void ResultWriter::put(const Expression & exp)
+{
+	const Atom & head = exp.head();
+	if (head.isNone())
+	{
+		m_buffer += "NONE";
+		return;
+	}
+
+	m_buffer += '(';
+
+	// the elements of lists and the parts of lambdas are printed without the head
+	bool list = head.isSymbol() && head.asText() == "list";
+	bool bare = list || (head.isSymbol() && head.asText() == "lambda");
+	if (list && head.isInsideLambda())
+		m_buffer += "list ";
+	if (!bare)
+		putAtom(head);
+
+	bool separate = !bare;
+	if (exp.isNumericSequence())
+	{
+		std::size_t size = exp.tailSize();
+		for (std::size_t k = 0; k < size; k++)
+		{
+			if (separate)
+				m_buffer += ' ';
+			separate = true;
+			m_buffer += '(';
+			putNumber(exp.tailAt(k).head().asNumber());
+			m_buffer += ')';
+			flushIfFull();
+		}
+	}
+	else
+	{
+		for (auto e = exp.tailConstBegin(); e != exp.tailConstEnd(); ++e)
+		{
+			if (separate)
+				m_buffer += ' ';
+			separate = true;
+			put(*e);
+			flushIfFull();
+		}
+	}
+
+	m_buffer += ')';
+}
+
+void ResultWriter::putAtom(const Atom & atom)
+{
+	if (atom.isNumber())
+		putNumber(atom.asNumber());
+	else if (atom.isSymbol())
+		m_buffer += atom.asText();
+	else if (atom.isComplexNumber())
+	{
+		putNumber(atom.asRealNumber());
+		m_buffer += ',';
+		putNumber(atom.asImaginaryNumber());
+	}
+	else if (atom.isStringConstant())
+	{
+		m_buffer += '"';
+		m_buffer += atom.asText();
+		m_buffer += '"';
+	}
+}
+
+void ResultWriter::putNumber(double value)
+{
+	char text[64];
+
+	// integers print the same with and without %g below its exponent threshold
+	if (value == std::floor(value) && std::fabs(value) < m_integerLimit)
+	{
+		char * end = text + sizeof(text);
+		char * begin = formatInteger(static_cast<unsigned long long>(std::fabs(value)), end);
+		if (std::signbit(value))
+			*--begin = '-';
+		m_buffer.append(begin, end);
+		return;
+	}
+
+	int length = std::snprintf(text, sizeof(text), "%.*g", m_precision, value);
+	m_buffer.append(text, length);
+}
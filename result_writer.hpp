@@ -0,0 +1,57 @@
+/*! \file result_writer.hpp
+Defines the writer printing expressions as the REPL shows them.
+
+The text of an expression is built in a buffer kept between calls, and
+written out in blocks when it goes to a stream, so printing a large list
+neither allocates per element nor holds the whole text in memory. Lists made
+by Expression::makeSequence or makeNumbers are printed without creating
+their elements.
+ */
+#ifndef RESULT_WRITER_HPP
+#define RESULT_WRITER_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include "expression.hpp"
+
+/// a stream is written to whenever the buffer holds this many bytes
+const std::size_t RESULT_FLUSH_BYTES = 1 << 16;
+
+/*! \class ResultWriter
+\brief Formats expressions into a reusable buffer.
+
+Numbers are printed like an ostream with the given precision and default
+flags prints them, so the output matches operator<< exactly.
+ */
+class ResultWriter
+{
+public:
+
+	/// print numbers with precision significant digits
+	explicit ResultWriter(int precision = 6);
+
+	/// the text of exp, valid until the next call
+	const std::string & format(const Expression & exp);
+
+	/// write the text of exp to out, a block at a time
+	void write(const Expression & exp, std::ostream & out);
+
+private:
+	std::string m_buffer;
+	int m_precision;
+
+	// numbers integral and smaller than this in magnitude print without an exponent
+	double m_integerLimit;
+
+	// stream the buffer is flushed to, nullptr when formatting
+	std::ostream * m_out = nullptr;
+
+	void put(const Expression & exp);
+	void putAtom(const Atom & atom);
+	void putNumber(double value);
+	void flushIfFull();
+};
+
+#endif
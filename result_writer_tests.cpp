@@ -0,0 +1,82 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include "result_writer.hpp"
+
+TEST_CASE("Test result writer formats like the REPL", "[result_writer]")
+{
+	ResultWriter writer;
+	REQUIRE(writer.format(Expression()) == "NONE");
+	REQUIRE(writer.format(Expression(Atom(3.))) == "(3)");
+
+	Atom text("hi"); text.setStringType();
+	Expression list(Atom("list"));
+	list.pushback(Expression(Atom(1.)));
+	list.pushback(Expression(Atom(ComplexNumber(0, -2.5))));
+	list.pushback(Expression(text));
+	Expression call(Atom("+"));
+	call.append(Atom("x"));
+	call.append(Atom(0.1234567));
+	list.pushback(call);
+	list.pushback(Expression(Atom("list")));
+	REQUIRE(writer.format(list) == "((1) (0,-2.5) (\"hi\") (+ (x) (0.123457)) ())");
+
+	Expression lambda(Atom("lambda"));
+	lambda.pushback(Expression(Atom("x")));
+	lambda.pushback(call);
+	REQUIRE(writer.format(lambda) == "((x) (+ (x) (0.123457)))");
+
+	Atom inner("list"); inner.setInsideLambda();
+	Expression quoted(inner);
+	quoted.append(Atom(2.));
+	REQUIRE(writer.format(quoted) == "(list (2))");
+
+	REQUIRE(writer.format(Expression::makeSequence(-1, 0.5, 4)) == "((-1) (-0.5) (0) (0.5))");
+}
+
+TEST_CASE("Test result writer numbers match ostream", "[result_writer]")
+{
+	std::vector<double> values = { 0, -0.0, 1, -7, 123456, 999999, 1000000, -1234567, 1e15, 1e300, 0.5, 1.0 / 3,
+		-2.718281828, 1e-5, 123456.5, 9999995, std::numeric_limits<double>::infinity() };
+
+	for (int precision : { 2, 6, 10 })
+	{
+		ResultWriter writer(precision);
+		for (double value : values)
+		{
+			std::ostringstream expected;
+			expected.precision(precision);
+			expected << "(" << value << ")";
+			INFO(expected.str());
+			REQUIRE(writer.format(Expression(Atom(value))) == expected.str());
+		}
+	}
+}
+
+TEST_CASE("Test result writer streams large lists", "[result_writer]")
+{
+	Expression numbers = Expression::makeSequence(0, 0.25, 100000);
+	Expression nested(Atom("list"));
+	for (int i = 0; i < 1000; i++)
+		nested.pushback(Expression::makeSequence(i, 1, 10));
+
+	for (const Expression & exp : { numbers, nested })
+	{
+		ResultWriter writer;
+		std::string text = writer.format(exp);
+
+		std::ostringstream out;
+		writer.write(exp, out);
+		REQUIRE(out.str() == text);
+
+		std::ostringstream streamed;
+		streamed << exp;
+		REQUIRE(streamed.str() == text);
+	}
+
+	REQUIRE(!numbers.isTailEmpty());
+	REQUIRE(numbers.isNumericSequence());
+}
@@ -0,0 +1,385 @@
+#include "serialization.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+
+#include "data_reader.hpp"
+#include "semantic_error.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// head kinds, the low bits of a tag
+enum NodeKind { NoneNode, NumberNode, SymbolNode, ComplexNode, StringNode };
+
+const unsigned char KIND_MASK = 0x07;
+const unsigned char NODE_TAIL = 1 << 3;
+const unsigned char NUMBER_TAIL = 1 << 4;
+const unsigned char PROPERTIES = 1 << 5;
+const unsigned char INSIDE_LAMBDA = 1 << 6;
+
+// number tails shorter than this are read into expressions right away
+const std::size_t PACKED_MIN = 16;
+
+// a tail element that can be stored as a bare double
+bool isPlainNumber(const Expression & exp)
+{
+	return exp.isHeadNumber() && exp.isTailEmpty() && exp.propertySize() == 0 && !exp.head().isInsideLambda();
+}
+
+bool hasNumberTail(const Expression & exp)
+{
+	std::size_t size = exp.tailSize();
+	for (std::size_t k = 0; k < size; k++)
+		if (!isPlainNumber(exp.tailAt(k)))
+			return false;
+	return size > 0;
+}
+
+// writes the string table and nodes of one expression
+class PlsbWriter
+{
+public:
+
+	explicit PlsbWriter(std::ostream & out) : m_out(out) {}
+
+	// add the strings of exp to the string table
+	void collect(const Expression & exp)
+	{
+		if (exp.head().isSymbol())
+			intern(exp.head().asSymbol());
+		else if (exp.head().isStringConstant())
+			intern(exp.head().asStringConstant());
+
+		if (!hasNumberTail(exp))
+			for (auto child = exp.tailConstBegin(); child != exp.tailConstEnd(); ++child)
+				collect(*child);
+
+		for (const std::string & keyword : exp.propertyKeywords())
+		{
+			intern(keyword);
+			collect(exp.getProperty(keyword));
+		}
+	}
+
+	void writeHeader()
+	{
+		m_out.write("PLSB", 4);
+		m_out.put(static_cast<char>(PLSB_VERSION));
+		varint(m_strings.size());
+		for (const std::string & text : m_strings)
+		{
+			varint(text.size());
+			m_out.write(text.data(), text.size());
+		}
+	}
+
+	void writeNode(const Expression & exp)
+	{
+		const Atom & head = exp.head();
+		std::vector<std::string> keywords = exp.propertyKeywords();
+		bool numbers = hasNumberTail(exp);
+
+		unsigned char tag = head.isNumber() ? NumberNode : head.isSymbol() ? SymbolNode :
+			head.isComplexNumber() ? ComplexNode : head.isStringConstant() ? StringNode : NoneNode;
+		if (numbers)
+			tag |= NUMBER_TAIL;
+		else if (!exp.isTailEmpty())
+			tag |= NODE_TAIL;
+		if (!keywords.empty())
+			tag |= PROPERTIES;
+		if (head.isInsideLambda())
+			tag |= INSIDE_LAMBDA;
+		m_out.put(static_cast<char>(tag));
+
+		switch (tag & KIND_MASK)
+		{
+		case NumberNode: number(head.asNumber()); break;
+		case SymbolNode: varint(m_index.at(head.asSymbol())); break;
+		case ComplexNode: number(head.asRealNumber()); number(head.asImaginaryNumber()); break;
+		case StringNode: varint(m_index.at(head.asStringConstant())); break;
+		}
+
+		if (numbers)
+		{
+			std::size_t size = exp.tailSize();
+			varint(size);
+			for (std::size_t k = 0; k < size; k++)
+				number(exp.tailAt(k).head().asNumber());
+		}
+		else if (!exp.isTailEmpty())
+		{
+			varint(exp.tailSize());
+			for (auto child = exp.tailConstBegin(); child != exp.tailConstEnd(); ++child)
+				writeNode(*child);
+		}
+
+		if (!keywords.empty())
+		{
+			varint(keywords.size());
+			for (const std::string & keyword : keywords)
+			{
+				varint(m_index.at(keyword));
+				writeNode(exp.getProperty(keyword));
+			}
+		}
+	}
+
+private:
+	std::ostream & m_out;
+	std::map<std::string, std::size_t> m_index;
+	std::vector<std::string> m_strings;
+
+	void intern(const std::string & text)
+	{
+		if (m_index.emplace(text, m_strings.size()).second)
+			m_strings.push_back(text);
+	}
+
+	void varint(std::size_t value)
+	{
+		do
+		{
+			unsigned char byte = value & 0x7f;
+			value >>= 7;
+			m_out.put(static_cast<char>(value ? (byte | 0x80) : byte));
+		} while (value);
+	}
+
+	void number(double value)
+	{
+		std::uint64_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		char bytes[8];
+		for (int i = 0; i < 8; i++, bits >>= 8)
+			bytes[i] = static_cast<char>(bits & 0xff);
+		m_out.write(bytes, 8);
+	}
+};
+
+// reads the string table and nodes of one expression, checking every bound
+class PlsbReader
+{
+public:
+
+	PlsbReader(const char * data, std::size_t size)
+		: m_pos(reinterpret_cast<const unsigned char *>(data)), m_end(m_pos + size) {}
+
+	void readHeader()
+	{
+		need(5);
+		if (std::memcmp(m_pos, "PLSB", 4) != 0)
+			throw SemanticError("Error: data is not in PLSB format");
+		if (m_pos[4] != PLSB_VERSION)
+			throw SemanticError("Error: unsupported PLSB version " + std::to_string(m_pos[4]));
+		m_pos += 5;
+
+		std::size_t count = varint();
+		need(count);
+		m_strings.reserve(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			std::size_t length = varint();
+			need(length);
+			m_strings.emplace_back(reinterpret_cast<const char *>(m_pos), length);
+			m_pos += length;
+		}
+	}
+
+	Expression readNode()
+	{
+		// a crafted file must not run the recursion out of stack
+		if (++m_depth > PLSB_MAX_DEPTH)
+			corrupt();
+		need(1);
+		unsigned char tag = *m_pos++;
+
+		Atom head;
+		switch (tag & KIND_MASK)
+		{
+		case NoneNode: break;
+		case NumberNode: head = Atom(number()); break;
+		case SymbolNode: head = Atom(string()); break;
+		case ComplexNode: { double real = number(); head = Atom(ComplexNumber(real, number())); break; }
+		case StringNode: head = Atom(string()); head.setStringType(); break;
+		default: corrupt();
+		}
+		if (tag & INSIDE_LAMBDA)
+			head.setInsideLambda();
+
+		Expression result(head);
+
+		if (tag & NUMBER_TAIL)
+		{
+			std::size_t size = varint();
+			needItems(size, 8);
+			if (size >= PACKED_MIN && !(tag & PROPERTIES))
+			{
+				auto values = std::make_shared<std::vector<double>>(size);
+				for (std::size_t k = 0; k < size; k++)
+					(*values)[k] = number();
+				result = Expression::makeNumbers(values);
+				result.head() = head;
+			}
+			else
+			{
+				result.reserveTail(size);
+				for (std::size_t k = 0; k < size; k++)
+					result.append(Atom(number()));
+			}
+		}
+		else if (tag & NODE_TAIL)
+		{
+			std::size_t size = varint();
+			need(size);
+			result.reserveTail(size);
+			for (std::size_t k = 0; k < size; k++)
+				result.pushback(readNode());
+		}
+
+		if (tag & PROPERTIES)
+		{
+			std::size_t size = varint();
+			need(size);
+			for (std::size_t k = 0; k < size; k++)
+			{
+				const std::string & keyword = string();
+				result.add_property(keyword, readNode());
+			}
+		}
+
+		m_depth--;
+		return result;
+	}
+
+	bool atEnd() const noexcept
+	{
+		return m_pos == m_end;
+	}
+
+private:
+	const unsigned char * m_pos;
+	const unsigned char * m_end;
+	std::vector<std::string> m_strings;
+	std::size_t m_depth = 0;
+
+	[[noreturn]] void corrupt() const
+	{
+		throw SemanticError("Error: corrupt PLSB data");
+	}
+
+	// at least count more bytes must remain
+	void need(std::size_t count) const
+	{
+		if (count > static_cast<std::size_t>(m_end - m_pos))
+			corrupt();
+	}
+
+	// at least count more items of width bytes must remain, without overflowing
+	void needItems(std::size_t count, std::size_t width) const
+	{
+		if (count > static_cast<std::size_t>(m_end - m_pos) / width)
+			corrupt();
+	}
+
+	std::size_t varint()
+	{
+		std::size_t value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			need(1);
+			unsigned char byte = *m_pos++;
+			value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80))
+				return value;
+		}
+		corrupt();
+	}
+
+	double number()
+	{
+		need(8);
+		std::uint64_t bits = 0;
+		for (int i = 7; i >= 0; i--)
+			bits = (bits << 8) | m_pos[i];
+		m_pos += 8;
+
+		double value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	const std::string & string()
+	{
+		std::size_t index = varint();
+		if (index >= m_strings.size())
+			corrupt();
+		return m_strings[index];
+	}
+};
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+void serializeExpression(const Expression & exp, std::ostream & out)
+{
+	PlsbWriter writer(out);
+	writer.collect(exp);
+	writer.writeHeader();
+	writer.writeNode(exp);
+}
+
+Expression deserializeExpression(const char * data, std::size_t size)
+{
+	PlsbReader reader(data, size);
+	reader.readHeader();
+	Expression result = reader.readNode();
+
+	if (!reader.atEnd())
+		throw SemanticError("Error: corrupt PLSB data");
+
+	return result;
+}
+
+bool saveExpression(const Expression & exp, const std::string & filename)
+{
+	std::ofstream out(filename, std::ios::binary);
+	serializeExpression(exp, out);
+	return bool(out);
+}
+
+Expression loadExpression(const std::string & filename)
+{
+	MappedFile file(filename);
+	return deserializeExpression(file.data(), file.size());
+}
+
+Expression saveproc(const std::vector<Expression> & args)
+{
+	if (args.size() != 2)
+		throw SemanticError("Error in call to save: invalid number of arguments");
+
+	if (!args[0].isHeadStringConstant())
+		throw SemanticError("Error in call to save: first argument is not a string");
+
+	if (!saveExpression(args[1], args[0].head().asStringConstant()))
+		throw SemanticError("Error in call to save: could not write " + args[0].head().asStringConstant());
+
+	return args[1];
+}
+
+Expression loadproc(const std::vector<Expression> & args)
+{
+	if (args.size() != 1)
+		throw SemanticError("Error in call to load: invalid number of arguments");
+
+	if (!args[0].isHeadStringConstant())
+		throw SemanticError("Error in call to load: first argument is not a string");
+
+	return loadExpression(args[0].head().asStringConstant());
+}
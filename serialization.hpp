@@ -0,0 +1,64 @@
+/*! \file serialization.hpp
+Defines PLSB, the binary encoding of Expressions.
+
+Unlike the text printed by operator<<, the encoding keeps properties and
+the kind of every atom, and it is read back without tokenizing or parsing.
+
+Layout, all integers are unsigned LEB128 varints unless noted:
+ - the magic bytes "PLSB" and a version byte
+ - the string table: a count, then each string as its length and bytes;
+   every symbol, string constant and property keyword is stored once here
+ - the root node
+
+A node is a tag byte, its head and then optionally its tail and properties.
+The low 3 bits of the tag give the head kind (0 none, 1 number, 2 symbol,
+3 complex, 4 string), bit 3 marks a tail of nodes, bit 4 a tail of plain
+numbers, bit 5 properties and bit 6 an atom inside a lambda. Numbers are 8
+byte little-endian doubles, a complex head is two of them and a symbol or
+string head is a string table index. A node tail is a count followed by the
+nodes, a number tail a count followed by the doubles. Properties are a count
+of (keyword index, node) pairs.
+ */
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "expression.hpp"
+
+/// version written by serializeExpression, the only one it can read
+const unsigned char PLSB_VERSION = 1;
+
+/// deepest nesting of expressions deserializeExpression reads
+const std::size_t PLSB_MAX_DEPTH = 1000;
+
+/// write exp in the PLSB encoding
+void serializeExpression(const Expression & exp, std::ostream & out);
+
+/*! Read an expression written by serializeExpression.
+
+Tails of plain numbers are restored as packed lists (see
+Expression::makeNumbers) and expand into expressions only when iterated.
+\param data the encoding
+\param size number of bytes of data
+\throws SemanticError if data is not a complete PLSB encoding of this version
+or nests deeper than PLSB_MAX_DEPTH
+ */
+Expression deserializeExpression(const char * data, std::size_t size);
+
+/// write exp to a file, false if it cannot be written
+bool saveExpression(const Expression & exp, const std::string & filename);
+
+/// read an expression from a memory mapped file, throws SemanticError if it cannot be read
+Expression loadExpression(const std::string & filename);
+
+/// procedure save: (save "file" exp) writes exp to file and returns exp
+Expression saveproc(const std::vector<Expression> & args);
+
+/// procedure load: (load "file") returns the expression saved in file
+Expression loadproc(const std::vector<Expression> & args);
+
+#endif
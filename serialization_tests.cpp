@@ -0,0 +1,145 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "serialization.hpp"
+
+Expression roundTrip(const Expression & exp)
+{
+	std::ostringstream out;
+	serializeExpression(exp, out);
+	std::string data = out.str();
+	return deserializeExpression(data.data(), data.size());
+}
+
+TEST_CASE("Test serializing atoms and trees", "[serialization]")
+{
+	Atom text("a \"quoted\" text"); text.setStringType();
+	Atom name("lambda"); name.setInsideLambda();
+
+	Expression tree(Atom("list"));
+	tree.pushback(Expression(Atom(3.25)));
+	tree.pushback(Expression(Atom(ComplexNumber(1, -2))));
+	tree.pushback(Expression(text));
+	tree.pushback(Expression());
+	Expression inner(name);
+	inner.pushback(Expression(Atom("x")));
+	inner.pushback(Expression(Atom(-0.5)));
+	tree.pushback(inner);
+
+	Expression copy = roundTrip(tree);
+	REQUIRE(copy == tree);
+	REQUIRE(copy.tailAt(1).head().isComplexNumber());
+	REQUIRE(copy.tailAt(2).head().isStringConstant());
+	REQUIRE(copy.tailAt(3).head().isNone());
+	REQUIRE(copy.tailAt(4).head().isInsideLambda());
+
+	REQUIRE(roundTrip(Expression()) == Expression());
+	REQUIRE(roundTrip(Expression(Atom("pi"))) == Expression(Atom("pi")));
+}
+
+TEST_CASE("Test serializing properties", "[serialization]")
+{
+	Atom label("label"); label.setStringType();
+	Expression text = makeText("title", makePoint(1, 2, 0), 2, 0.5);
+	text.add_property("note", Expression(label));
+
+	Expression copy = roundTrip(text);
+	REQUIRE(copy == text);
+	REQUIRE(copy.propertySize() == text.propertySize());
+	REQUIRE(copy.graphicKind() == TextGraphic);
+	REQUIRE(copy.graphicSlot(TextRotationSlot) == 0.5);
+	REQUIRE(copy.graphicPosition() != nullptr);
+	REQUIRE(copy.graphicPosition()->graphicKind() == PointGraphic);
+	REQUIRE(copy.getProperty("note") == Expression(label));
+}
+
+TEST_CASE("Test serialized form is compact", "[serialization]")
+{
+	Atom repeated("a long string repeated in every element"); repeated.setStringType();
+	Expression strings(Atom("list"));
+	for (int i = 0; i < 100; i++)
+		strings.pushback(Expression(repeated));
+
+	std::ostringstream out;
+	serializeExpression(strings, out);
+	REQUIRE(out.str().size() < 300);
+	REQUIRE(roundTrip(strings) == strings);
+
+	// numbers are packed, a range is written without expanding it
+	Expression numbers = Expression::makeSequence(0, 0.25, 1000);
+	std::ostringstream packed;
+	serializeExpression(numbers, packed);
+	REQUIRE(packed.str().size() < 1000 * 8 + 32);
+	REQUIRE(roundTrip(numbers) == numbers);
+}
+
+TEST_CASE("Test reading invalid serialized data", "[serialization]")
+{
+	std::ostringstream out;
+	serializeExpression(makeLine(makePoint(0, 0, 0), makePoint(1, 1, 0)), out);
+	std::string data = out.str();
+
+	for (std::size_t size = 0; size < data.size(); size++)
+		REQUIRE_THROWS_AS(deserializeExpression(data.data(), size), const SemanticError &);
+
+	std::string extra = data + "x";
+	REQUIRE_THROWS_AS(deserializeExpression(extra.data(), extra.size()), const SemanticError &);
+
+	std::string magic = "PLSX" + data.substr(4);
+	REQUIRE_THROWS_WITH(deserializeExpression(magic.data(), magic.size()), "Error: data is not in PLSB format");
+
+	std::string version = data;
+	version[4] = 99;
+	REQUIRE_THROWS_WITH(deserializeExpression(version.data(), version.size()), "Error: unsupported PLSB version 99");
+
+	// tags of a node without a head followed by a tail of numbers or of nodes,
+	// after a header with an empty string table
+	const char numberList = 0x10, nodeList = 0x08;
+	std::string header = std::string("PLSB") + char(PLSB_VERSION) + '\0';
+
+	// a count of 2^61 numbers is 0 bytes once multiplied by 8
+	std::string huge = header + numberList + "\x80\x80\x80\x80\x80\x80\x80\x80\x20";
+	REQUIRE_THROWS_WITH(deserializeExpression(huge.data(), huge.size()), "Error: corrupt PLSB data");
+
+	// lists nested up to the limit and one deeper, each holding the next
+	std::string deep = header;
+	for (std::size_t depth = 1; depth < PLSB_MAX_DEPTH; depth++)
+		deep += std::string(1, nodeList) + '\1';
+	std::string deeper = deep + nodeList + '\1' + '\0';
+	deep += '\0';
+	REQUIRE_NOTHROW(deserializeExpression(deep.data(), deep.size()));
+	REQUIRE_THROWS_WITH(deserializeExpression(deeper.data(), deeper.size()), "Error: corrupt PLSB data");
+}
+
+TEST_CASE("Test save and load procedures", "[serialization]")
+{
+	std::string program = "(begin (define f (lambda (x) (list x (* 2 x)))) "
+	                      "(save \"serialization_test.plsb\" (discrete-plot (map f (range -2 2 0.5)) (list (list \"title\" \"T\")))))";
+
+	Interpreter interp;
+	std::istringstream iss(program);
+	REQUIRE(interp.parseStream(iss));
+	Expression plot = interp.evaluate();
+
+	std::istringstream load("(load \"serialization_test.plsb\")");
+	REQUIRE(interp.parseStream(load));
+	Expression loaded = interp.evaluate();
+	std::remove("serialization_test.plsb");
+
+	REQUIRE(loaded == plot);
+	for (int k = 0; k < plot.tailSize(); k++)
+		REQUIRE(loaded.tailAt(k).graphicKind() == plot.tailAt(k).graphicKind());
+
+	std::vector<std::string> bad = { "(load \"serialization_missing.plsb\")", "(load 1)", "(save 1 2)", "(save \"x\")" };
+	for (auto text : bad)
+	{
+		INFO(text);
+		std::istringstream in(text);
+		REQUIRE(interp.parseStream(in));
+		REQUIRE_THROWS_AS(interp.evaluate(), const SemanticError &);
+	}
+}
@@ -0,0 +1,119 @@
+#include "spatial_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void SpatialGrid::build(const DrawBuffer & buffer)
+{
+	clear();
+
+	for (std::size_t i = 0; i < buffer.size(); i++)
+	{
+		const DrawCommand & command = buffer[i];
+		if (command.kind == DrawCommand::PointKind)
+		{
+			double radius = std::max(command.size, 0.0) / 2;
+			Item item = { i, command.x1 - radius, command.y1 - radius, command.x1 + radius, command.y1 + radius };
+			m_items.push_back(item);
+		}
+		else if (command.kind == DrawCommand::LineKind)
+		{
+			Item item = { i, std::min(command.x1, command.x2), std::min(command.y1, command.y2),
+				std::max(command.x1, command.x2), std::max(command.y1, command.y2) };
+			m_items.push_back(item);
+		}
+		else
+		{
+			m_always.push_back(i);
+		}
+	}
+
+	if (m_items.empty())
+		return;
+
+	for (auto & item : m_items)
+	{
+		m_bounds.include(item.xMin, item.yMin);
+		m_bounds.include(item.xMax, item.yMax);
+	}
+
+	std::size_t side = static_cast<std::size_t>(std::ceil(std::sqrt(double(m_items.size()) / GRID_ITEMS_PER_CELL)));
+	m_columns = std::max<std::size_t>(1, side);
+	m_rows = m_columns;
+	m_cellWidth = (m_bounds.xMax - m_bounds.xMin) / m_columns;
+	m_cellHeight = (m_bounds.yMax - m_bounds.yMin) / m_rows;
+	if (!(m_cellWidth > 0)) m_cellWidth = 1;
+	if (!(m_cellHeight > 0)) m_cellHeight = 1;
+
+	// first pass counts the items of each cell, second pass fills them in
+	m_cellStart.assign(m_columns * m_rows + 1, 0);
+	for (auto & item : m_items)
+		for (std::size_t row = rowOf(item.yMin); row <= rowOf(item.yMax); row++)
+			for (std::size_t column = columnOf(item.xMin); column <= columnOf(item.xMax); column++)
+				m_cellStart[row * m_columns + column + 1]++;
+
+	for (std::size_t cell = 1; cell < m_cellStart.size(); cell++)
+		m_cellStart[cell] += m_cellStart[cell - 1];
+
+	std::vector<std::size_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+	m_entries.resize(m_cellStart.back());
+	for (std::size_t id = 0; id < m_items.size(); id++)
+	{
+		const Item & item = m_items[id];
+		for (std::size_t row = rowOf(item.yMin); row <= rowOf(item.yMax); row++)
+			for (std::size_t column = columnOf(item.xMin); column <= columnOf(item.xMax); column++)
+				m_entries[fill[row * m_columns + column]++] = id;
+	}
+}
+
+void SpatialGrid::clear() noexcept
+{
+	m_bounds = DrawBounds();
+	m_columns = 0;
+	m_rows = 0;
+	m_items.clear();
+	m_cellStart.clear();
+	m_entries.clear();
+	m_always.clear();
+}
+
+void SpatialGrid::visible(double xMin, double yMin, double xMax, double yMax, std::vector<std::size_t> & result) const
+{
+	result.assign(m_always.begin(), m_always.end());
+
+	if (m_items.empty() || xMax < m_bounds.xMin || xMin > m_bounds.xMax
+		|| yMax < m_bounds.yMin || yMin > m_bounds.yMax)
+		return;
+
+	for (std::size_t row = rowOf(yMin); row <= rowOf(yMax); row++)
+	{
+		for (std::size_t column = columnOf(xMin); column <= columnOf(xMax); column++)
+		{
+			std::size_t cell = row * m_columns + column;
+			for (std::size_t entry = m_cellStart[cell]; entry < m_cellStart[cell + 1]; entry++)
+			{
+				const Item & item = m_items[m_entries[entry]];
+				if (item.xMax >= xMin && item.xMin <= xMax && item.yMax >= yMin && item.yMin <= yMax)
+					result.push_back(item.index);
+			}
+		}
+	}
+
+	// items spanning several cells are found once per cell
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+std::size_t SpatialGrid::columnOf(double x) const
+{
+	double column = std::floor((x - m_bounds.xMin) / m_cellWidth);
+	if (!(column > 0)) return 0;
+	return std::min(static_cast<std::size_t>(column), m_columns - 1);
+}
+
+std::size_t SpatialGrid::rowOf(double y) const
+{
+	double row = std::floor((y - m_bounds.yMin) / m_cellHeight);
+	if (!(row > 0)) return 0;
+	return std::min(static_cast<std::size_t>(row), m_rows - 1);
+}
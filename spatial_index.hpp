@@ -0,0 +1,71 @@
+/*! \file spatial_index.hpp
+Defines the SpatialGrid, a uniform grid over the primitives of a DrawBuffer.
+
+Plot content is static once evaluated, so the grid is built once per result
+in a flat (counting sort) layout and then only queried with the viewport.
+ */
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "draw_buffer.hpp"
+
+/// average number of primitives the grid aims for in each cell
+const std::size_t GRID_ITEMS_PER_CELL = 8;
+
+/*! \class SpatialGrid
+\brief Uniform grid mapping scene regions to the points and lines in them.
+
+Texts, outputs and errors are not indexed, they are always reported visible.
+ */
+class SpatialGrid
+{
+public:
+
+	/// index every point and line of buffer, replacing the previous content
+	void build(const DrawBuffer & buffer);
+
+	/// remove all content
+	void clear() noexcept;
+
+	/*! Collect the commands to draw for a viewport.
+	\param xMin left edge of the viewport in scene units
+	\param yMin top edge of the viewport in scene units
+	\param xMax right edge of the viewport in scene units
+	\param yMax bottom edge of the viewport in scene units
+	\param result receives the indices, ascending so painting order is kept
+	 */
+	void visible(double xMin, double yMin, double xMax, double yMax, std::vector<std::size_t> & result) const;
+
+private:
+
+	// extent of the indexed content and grid resolution
+	DrawBounds m_bounds;
+	std::size_t m_columns = 0;
+	std::size_t m_rows = 0;
+	double m_cellWidth = 1;
+	double m_cellHeight = 1;
+
+	// bounding box of an indexed command
+	struct Item
+	{
+		std::size_t index;
+		double xMin, yMin, xMax, yMax;
+	};
+	std::vector<Item> m_items;
+
+	// items of cell c are m_entries[m_cellStart[c] .. m_cellStart[c+1])
+	std::vector<std::size_t> m_cellStart;
+	std::vector<std::size_t> m_entries;
+
+	// commands that are not indexed
+	std::vector<std::size_t> m_always;
+
+	// helpers mapping scene coordinates to clamped cell indices
+	std::size_t columnOf(double x) const;
+	std::size_t rowOf(double y) const;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#include "catch.hpp"
+
+#include <algorithm>
+
+#include "spatial_index.hpp"
+
+TEST_CASE("Test spatial grid returns everything for the full extent", "[spatial_index]")
+{
+	DrawBuffer buffer;
+	for (int i = 0; i < 1000; i++)
+		buffer.addPoint(i, i % 10, 0.5);
+	buffer.addText(500, -5, 0, 1, "title");
+
+	SpatialGrid grid;
+	grid.build(buffer);
+
+	std::vector<std::size_t> shown;
+	grid.visible(-10, -10, 1010, 20, shown);
+
+	REQUIRE(shown.size() == buffer.size());
+	for (std::size_t i = 0; i < shown.size(); i++)
+		REQUIRE(shown[i] == i);
+}
+
+TEST_CASE("Test spatial grid culls primitives outside the viewport", "[spatial_index]")
+{
+	DrawBuffer buffer;
+	for (int i = 0; i < 1000; i++)
+		buffer.addLine(i, 0, i, 10, 0);
+	// a border spanning every cell
+	buffer.addLine(0, 10, 999, 10, 0);
+	buffer.addText(500, -5, 0, 1, "title");
+
+	SpatialGrid grid;
+	grid.build(buffer);
+
+	std::vector<std::size_t> shown;
+	grid.visible(99.5, 2, 110.5, 3, shown);
+
+	// 11 stems plus the text, in painting order
+	REQUIRE(shown.size() == 12);
+	REQUIRE(shown.front() == 100);
+	REQUIRE(shown.back() == 1001);
+
+	grid.visible(99.5, 9, 110.5, 11, shown);
+	REQUIRE(shown.size() == 13);
+	REQUIRE(std::count(shown.begin(), shown.end(), 1000) == 1);
+
+	grid.visible(2000, 2000, 3000, 3000, shown);
+	REQUIRE(shown.size() == 1);
+	REQUIRE(buffer.subset(shown)[0].kind == DrawCommand::TextKind);
+}
+
+TEST_CASE("Test spatial grid on degenerate content", "[spatial_index]")
+{
+	DrawBuffer buffer;
+	buffer.addPoint(1, 1, 0);
+	buffer.addPoint(1, 1, 0);
+
+	SpatialGrid grid;
+	grid.build(buffer);
+
+	std::vector<std::size_t> shown;
+	grid.visible(0, 0, 2, 2, shown);
+	REQUIRE(shown.size() == 2);
+
+	grid.clear();
+	grid.visible(0, 0, 2, 2, shown);
+	REQUIRE(shown.empty());
+}
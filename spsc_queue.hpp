@@ -0,0 +1,198 @@
+/*! \file spsc_queue.hpp
+Defines a bounded queue between one producer and one consumer thread.
+
+Pushing and popping are lock free: each side owns one index of a ring of
+slots and only reads the other side's. Elements are moved in and out, never
+copied. The blocking push and pop spin briefly and then sleep on a
+condition variable, which the other side only signals when someone sleeps,
+so a busy queue never touches the mutex.
+ */
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+/// tries of a blocking push or pop before it sleeps
+const int SPSC_SPIN_TRIES = 64;
+
+/// bytes of a cache line, the distance kept between the two indexes
+const std::size_t SPSC_CACHE_LINE = 64;
+
+/*! \class SpscQueue
+\brief Bounded lock-free single-producer single-consumer queue.
+
+Exactly one thread may push and exactly one thread may pop at any time.
+T must be default constructible and move assignable.
+ */
+template <typename T>
+class SpscQueue
+{
+public:
+
+	/// make a queue holding at least capacity elements, rounded up to a power of two
+	explicit SpscQueue(std::size_t capacity = 1024)
+	{
+		m_mask = 1;
+		while (m_mask < capacity)
+			m_mask <<= 1;
+		m_slots.reset(new T[m_mask]);
+		m_mask -= 1;
+	}
+
+	SpscQueue(const SpscQueue &) = delete;
+	SpscQueue & operator=(const SpscQueue &) = delete;
+
+	// before C++17 new does not honour the alignment of the indexes, so a
+	// queue on the heap aligns itself and keeps the block just in front
+	static void * operator new(std::size_t size)
+	{
+		void * block = std::malloc(size + SPSC_CACHE_LINE + sizeof(void *));
+		if (block == nullptr)
+			throw std::bad_alloc();
+
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(block) + sizeof(void *);
+		std::uintptr_t aligned = (start + SPSC_CACHE_LINE - 1) & ~std::uintptr_t(SPSC_CACHE_LINE - 1);
+		reinterpret_cast<void **>(aligned)[-1] = block;
+		return reinterpret_cast<void *>(aligned);
+	}
+
+	static void operator delete(void * queue) noexcept
+	{
+		if (queue != nullptr)
+			std::free(static_cast<void **>(queue)[-1]);
+	}
+
+	/// number of elements the queue holds when full
+	std::size_t capacity() const noexcept
+	{
+		return m_mask + 1;
+	}
+
+	/// move value into the queue, false (leaving value alone) if it is full
+	bool tryPush(T & value)
+	{
+		std::size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_headCache > m_mask)
+		{
+			m_headCache = m_head.load(std::memory_order_acquire);
+			if (tail - m_headCache > m_mask)
+				return false;
+		}
+
+		m_slots[tail & m_mask] = std::move(value);
+		m_tail.store(tail + 1, std::memory_order_seq_cst);
+		wake(m_consumerSleeping, m_notEmpty);
+		return true;
+	}
+
+	bool tryPush(T && value)
+	{
+		return tryPush(value);
+	}
+
+	/// move value into the queue, waiting while it is full
+	void push(T value)
+	{
+		for (int i = 0; i < SPSC_SPIN_TRIES; i++)
+		{
+			if (tryPush(value))
+				return;
+			std::this_thread::yield();
+		}
+
+		while (!tryPush(value))
+			sleep(m_producerSleeping, m_notFull, [this]() {
+				return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_seq_cst) <= m_mask;
+			});
+	}
+
+	/// move the oldest element into value, false if the queue is empty
+	bool tryPop(T & value)
+	{
+		std::size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tailCache)
+		{
+			m_tailCache = m_tail.load(std::memory_order_acquire);
+			if (head == m_tailCache)
+				return false;
+		}
+
+		value = std::move(m_slots[head & m_mask]);
+		m_head.store(head + 1, std::memory_order_seq_cst);
+		wake(m_producerSleeping, m_notFull);
+		return true;
+	}
+
+	/// move the oldest element into value, waiting while the queue is empty
+	void pop(T & value)
+	{
+		for (int i = 0; i < SPSC_SPIN_TRIES; i++)
+		{
+			if (tryPop(value))
+				return;
+			std::this_thread::yield();
+		}
+
+		while (!tryPop(value))
+			sleep(m_consumerSleeping, m_notEmpty, [this]() {
+				return m_tail.load(std::memory_order_seq_cst) != m_head.load(std::memory_order_relaxed);
+			});
+	}
+
+	/// true if nothing is queued, exact only on the consumer thread
+	bool empty() const noexcept
+	{
+		return m_tail.load(std::memory_order_acquire) == m_head.load(std::memory_order_acquire);
+	}
+
+private:
+
+	// the indexes grow without wrapping around the ring, the slot of index i
+	// is i & m_mask; they sit on separate cache lines so the two threads do
+	// not invalidate each other's line on every operation
+	alignas(SPSC_CACHE_LINE) std::atomic<std::size_t> m_head{ 0 };
+	std::size_t m_tailCache = 0;
+
+	alignas(SPSC_CACHE_LINE) std::atomic<std::size_t> m_tail{ 0 };
+	std::size_t m_headCache = 0;
+
+	alignas(SPSC_CACHE_LINE) std::size_t m_mask;
+	std::unique_ptr<T[]> m_slots;
+
+	std::mutex m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+	std::atomic<bool> m_consumerSleeping{ false };
+	std::atomic<bool> m_producerSleeping{ false };
+
+	// the sleeper sets its flag before checking the indexes and the other side
+	// writes its index before reading the flag, so one of them sees the other
+	template <typename Ready>
+	void sleep(std::atomic<bool> & sleeping, std::condition_variable & condition, Ready ready)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		sleeping.store(true, std::memory_order_seq_cst);
+		condition.wait(lock, ready);
+		sleeping.store(false, std::memory_order_relaxed);
+	}
+
+	void wake(std::atomic<bool> & sleeping, std::condition_variable & condition)
+	{
+		if (sleeping.load(std::memory_order_seq_cst))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			condition.notify_one();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "spsc_queue.hpp"
+
+TEST_CASE("Test ring buffer on one thread", "[spsc_queue]")
+{
+	SpscQueue<std::string> queue(3);
+	REQUIRE(queue.capacity() == 4);
+	REQUIRE(queue.empty());
+
+	std::string value;
+	REQUIRE(!queue.tryPop(value));
+	for (int i = 0; i < 4; i++)
+		REQUIRE(queue.tryPush(std::to_string(i)));
+
+	std::string extra = "extra";
+	REQUIRE(!queue.tryPush(extra));
+	REQUIRE(extra == "extra");
+
+	// wraps around the ring
+	for (int round = 0; round < 10; round++)
+	{
+		REQUIRE(queue.tryPop(value));
+		REQUIRE(value == std::to_string(round));
+		REQUIRE(queue.tryPush(std::to_string(round + 4)));
+	}
+	REQUIRE(!queue.empty());
+
+	// the indexes keep their cache lines on the heap as well
+	std::unique_ptr<SpscQueue<std::string>> heap(new SpscQueue<std::string>(2));
+	REQUIRE(reinterpret_cast<std::uintptr_t>(heap.get()) % SPSC_CACHE_LINE == 0);
+	REQUIRE(heap->tryPush(extra));
+	REQUIRE(heap->tryPop(value));
+	REQUIRE(value == "extra");
+}
+
+TEST_CASE("Test ring buffer moves elements", "[spsc_queue]")
+{
+	SpscQueue<std::unique_ptr<int>> queue(2);
+	std::unique_ptr<int> item(new int(7));
+	REQUIRE(queue.tryPush(item));
+	REQUIRE(item == nullptr);
+
+	std::unique_ptr<int> out;
+	queue.pop(out);
+	REQUIRE(*out == 7);
+}
+
+TEST_CASE("Test ring buffer between two threads", "[spsc_queue]")
+{
+	// a small ring makes both sides wait for each other
+	SpscQueue<long> queue(8);
+	const long count = 200000;
+
+	std::thread producer([&queue, count]() {
+		for (long i = 0; i < count; i++)
+			queue.push(i);
+	});
+
+	long expected = 0;
+	bool ordered = true;
+	for (long i = 0; i < count; i++)
+	{
+		long value;
+		queue.pop(value);
+		ordered = ordered && (value == expected++);
+	}
+	producer.join();
+
+	REQUIRE(ordered);
+	REQUIRE(queue.empty());
+}
@@ -0,0 +1,66 @@
+#include "startup_snapshot.hpp"
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+
+/************************************************************************************************************************************
+Helper Functions
+**************************************************************************************************************************************/
+
+// memoized snapshots by program hash, the program text guards against collisions
+std::mutex snapshot_mutex;
+std::multimap<std::size_t, std::pair<std::string, Environment>> snapshots;
+
+Environment evaluateStartup(const std::string & program)
+{
+	std::istringstream in(program);
+	Interpreter interp;
+
+	if (!interp.parseStream(in))
+		throw SemanticError("Error: Invalid Expression. Could not parse.");
+
+	interp.evaluate();
+	return interp.environment();
+}
+
+/************************************************************************************************************************************
+END
+**************************************************************************************************************************************/
+
+Environment startupEnvironment(const std::string & program)
+{
+	std::size_t hash = std::hash<std::string>()(program);
+
+	{
+		std::lock_guard<std::mutex> lock(snapshot_mutex);
+		auto range = snapshots.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+			if (it->second.first == program)
+				return it->second.second;
+	}
+
+	// evaluate outside the lock, two threads racing on a new program both evaluate it
+	Environment snapshot = evaluateStartup(program);
+
+	std::lock_guard<std::mutex> lock(snapshot_mutex);
+	snapshots.emplace(hash, std::make_pair(program, snapshot));
+	return snapshot;
+}
+
+Environment startupEnvironmentFromFile(const std::string & filename)
+{
+	std::ifstream in(filename);
+	if (!in)
+		throw SemanticError("Error: Can't open file " + filename + ".");
+
+	std::ostringstream program;
+	program << in.rdbuf();
+	return startupEnvironment(program.str());
+}
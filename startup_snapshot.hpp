@@ -0,0 +1,29 @@
+/*! \file startup_snapshot.hpp
+Defines the snapshot of the environment after the startup program.
+
+Kernels, resets and batch jobs all start from the same startup program. It
+is evaluated once per program text and every new interpreter starts from a
+copy of the resulting environment, which shares its definitions until the
+interpreter defines something of its own.
+ */
+#ifndef STARTUP_SNAPSHOT_HPP
+#define STARTUP_SNAPSHOT_HPP
+
+#include <string>
+
+#include "environment.hpp"
+
+/*! Get the environment resulting from evaluating a startup program.
+
+Results are memoized by a hash of the program text, so only the first call
+for a given program parses and evaluates it. Failures are not memoized.
+\param program the text of the startup program
+\return the environment after the program, sharing the memoized definitions
+\throws SemanticError if the program does not parse or fails to evaluate
+ */
+Environment startupEnvironment(const std::string & program);
+
+/// read a startup file and return startupEnvironment of its content, throws SemanticError if it cannot be read
+Environment startupEnvironmentFromFile(const std::string & filename);
+
+#endif
@@ -0,0 +1,33 @@
+#include "catch.hpp"
+
+#include "interpreter.hpp"
+#include "semantic_error.hpp"
+#include "startup_snapshot.hpp"
+#include "test_helpers.hpp"
+
+TEST_CASE("Test interpreters start from the startup snapshot", "[startup_snapshot]")
+{
+	std::string startup = "(begin (define offset 10) (define shift (lambda (x) (+ x offset))))";
+
+	Environment snapshot = startupEnvironment(startup);
+
+	REQUIRE(evaluateProgram("(shift 5)", snapshot) == Expression(15.));
+	REQUIRE(evaluateProgram("(shift 1)", startupEnvironment(startup)) == Expression(11.));
+}
+
+TEST_CASE("Test interpreters from one snapshot are independent", "[startup_snapshot]")
+{
+	Environment snapshot = startupEnvironment("(define base 1)");
+
+	REQUIRE(evaluateProgram("(begin (define base 2) (define other 3) base)", snapshot) == Expression(2.));
+	REQUIRE(evaluateProgram("(begin base)", snapshot) == Expression(1.));
+	REQUIRE_THROWS_AS(evaluateProgram("(begin other)", snapshot), const SemanticError &);
+	REQUIRE(evaluateProgram("(begin base)", startupEnvironment("(define base 1)")) == Expression(1.));
+}
+
+TEST_CASE("Test failing startup programs", "[startup_snapshot]")
+{
+	REQUIRE_THROWS_AS(startupEnvironment("(define"), const SemanticError &);
+	REQUIRE_THROWS_AS(startupEnvironment("(undefined-procedure)"), const SemanticError &);
+	REQUIRE_THROWS_AS(startupEnvironmentFromFile("no_such_startup_file.pls"), const SemanticError &);
+}
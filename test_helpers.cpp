@@ -0,0 +1,30 @@
+#include "catch.hpp"
+
+#include "test_helpers.hpp"
+
+#include <sstream>
+
+#include "parse.hpp"
+
+Expression parseProgram(const std::string & program)
+{
+	INFO(program);
+	Expression ast;
+	std::istringstream iss(program);
+	REQUIRE(parse(tokenize(iss), ast));
+	return ast;
+}
+
+Expression evaluateIn(Interpreter & interp, const std::string & program)
+{
+	INFO(program);
+	std::istringstream iss(program);
+	REQUIRE(interp.parseStream(iss));
+	return interp.evaluate();
+}
+
+Expression evaluateProgram(const std::string & program, const Environment & start)
+{
+	Interpreter interp(start);
+	return evaluateIn(interp, program);
+}
@@ -0,0 +1,22 @@
+/*! \file test_helpers.hpp
+Helpers shared by the unit tests for running plotscript programs.
+ */
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+#include <string>
+
+#include "environment.hpp"
+#include "expression.hpp"
+#include "interpreter.hpp"
+
+/// parse program, which is required to parse
+Expression parseProgram(const std::string & program);
+
+/// parse program into interp and evaluate it there; evaluation errors propagate
+Expression evaluateIn(Interpreter & interp, const std::string & program);
+
+/// evaluate program in a new interpreter starting from start; evaluation errors propagate
+Expression evaluateProgram(const std::string & program, const Environment & start = Environment());
+
+#endif